@@ -0,0 +1,164 @@
+#include "precomp.h"
+#include "allocation_tracker.h"
+
+namespace Tmpl8
+{
+
+//Constant initialized, so it is ready before the first allocation of any static constructor
+std::array<AllocationTracker::ThreadSlot, AllocationTracker::max_threads> AllocationTracker::slots;
+
+AllocationTracker::Totals& AllocationTracker::Totals::operator+=(const Totals& other)
+{
+    allocations += other.allocations;
+    bytes += other.bytes;
+    frees += other.frees;
+    return *this;
+}
+
+AllocationTracker::Totals AllocationTracker::Totals::operator-(const Totals& other) const
+{
+    return { allocations - other.allocations, bytes - other.bytes, frees - other.frees };
+}
+
+// -----------------------------------------------------------
+// Slot of the calling thread, taken on its first tracked allocation
+// Must not allocate, it runs inside operator new
+// -----------------------------------------------------------
+AllocationTracker::ThreadSlot& AllocationTracker::get_slot()
+{
+    if (slot_index < 0)
+    {
+        slot_index = std::min(slots_used.fetch_add(1), max_threads - 1);
+        slots[slot_index].worker = ThreadPool::get_current_worker();
+    }
+    return slots[slot_index];
+}
+
+AllocationTracker::Totals AllocationTracker::read(const Counter& counter)
+{
+    return { counter.allocations.load(std::memory_order_relaxed), counter.bytes.load(std::memory_order_relaxed), counter.frees.load(std::memory_order_relaxed) };
+}
+
+AllocationTracker::Totals AllocationTracker::get_section_total(int section)
+{
+    Totals total;
+    for (int thread = 0; thread < get_thread_count(); thread++) total += read(slots[thread].sections[section + 1]);
+    return total;
+}
+
+AllocationTracker::Totals AllocationTracker::get_total()
+{
+    Totals total;
+    for (int thread = 0; thread < get_thread_count(); thread++) total += get_thread_total(thread);
+    return total;
+}
+
+int AllocationTracker::get_thread_count()
+{
+    return std::min(slots_used.load(), max_threads);
+}
+
+AllocationTracker::Totals AllocationTracker::get_thread_total(int thread)
+{
+    Totals total;
+    for (const Counter& counter : slots[thread].sections) total += read(counter);
+    return total;
+}
+
+const char* AllocationTracker::get_thread_name(int thread, char* buffer)
+{
+    if (thread == max_threads - 1 && slots_used.load() > max_threads) sprintf(buffer, "others");
+    else if (slots[thread].worker >= 0) sprintf(buffer, "worker %i", slots[thread].worker);
+    else sprintf(buffer, "main");
+    return buffer;
+}
+
+void AllocationTracker::reset()
+{
+    for (ThreadSlot& slot : slots)
+    {
+        for (Counter& counter : slot.sections)
+        {
+            counter.allocations.store(0, std::memory_order_relaxed);
+            counter.bytes.store(0, std::memory_order_relaxed);
+            counter.frees.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// -----------------------------------------------------------
+// Alignments above the default (alignas types) come from the aligned
+// allocator, and must be freed with aligned set
+// -----------------------------------------------------------
+void* allocate_counted(size_t size, size_t alignment)
+{
+    AllocationTracker::count.fetch_add(1, std::memory_order_relaxed);
+    if (AllocationTracker::is_enabled())
+    {
+        AllocationTracker::Counter& counter = AllocationTracker::get_slot().sections[AllocationTracker::current_section + 1];
+        counter.allocations.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    //operator new(0) must still return a unique pointer
+    void* memory;
+    if (alignment == 0) memory = malloc(size ? size : 1);
+#ifdef _MSC_VER
+    else memory = _aligned_malloc(size ? size : 1, alignment);
+#else
+    else memory = aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment); //Size must be a multiple of the alignment
+#endif
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void free_counted(void* memory, bool aligned)
+{
+    if (memory && AllocationTracker::is_enabled())
+    {
+        AllocationTracker::get_slot().sections[AllocationTracker::current_section + 1].frees.fetch_add(1, std::memory_order_relaxed);
+    }
+#ifdef _MSC_VER
+    if (aligned) _aligned_free(memory);
+    else free(memory);
+#else
+    (void)aligned;
+    free(memory);
+#endif
+}
+
+} // namespace Tmpl8
+
+// -----------------------------------------------------------
+// Replacements of the global allocation functions, the array and nothrow
+// versions of the standard library forward to these
+// -----------------------------------------------------------
+void* operator new(size_t size)
+{
+    return Tmpl8::allocate_counted(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return Tmpl8::allocate_counted(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    Tmpl8::free_counted(memory, false);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    Tmpl8::free_counted(memory, false);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    Tmpl8::free_counted(memory, true);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+    Tmpl8::free_counted(memory, true);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Hook on the global operator new and delete.
+// Every allocation of the process is counted (get_count), which is all the hook
+// does until enable() is called. Once enabled every thread also keeps its own
+// counts and bytes per section, so tracking doesn't make threads contend.
+//
+// Sections are the phases of the frame: PhaseTimer sets the section of the thread
+// it runs on, and pool tasks run in the section of the thread that enqueued them,
+// so an allocation in a worker counts for the phase that handed out the work.
+// A nested section takes the allocations away from the one around it.
+// -----------------------------------------------------------
+class AllocationTracker
+{
+  public:
+    static constexpr int max_sections = 16;
+    static constexpr int max_threads = 128; //Threads after that are tracked together in the last slot
+    static constexpr int no_section = -1;
+
+    struct Totals
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0; //Requested, without the allocator's overhead
+        uint64_t frees = 0;
+
+        Totals& operator+=(const Totals& other);
+        Totals operator-(const Totals& other) const;
+    };
+
+    //Every allocation since the process started, also while tracking is disabled
+    static uint64_t get_count() { return count.load(std::memory_order_relaxed); }
+
+    static void enable() { enabled.store(true, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    //Section of the calling thread, no_section outside of all phases
+    static int get_section() { return current_section; }
+    static void set_section(int section) { current_section = section; }
+
+    //Summed over all threads, no_section gives the allocations outside of all sections
+    static Totals get_section_total(int section);
+    static Totals get_total();
+
+    //Threads in the order they first allocated while tracking
+    static int get_thread_count();
+    static Totals get_thread_total(int thread);
+    static const char* get_thread_name(int thread, char* buffer);
+
+    //Zero every count, call while no other thread allocates
+    static void reset();
+
+  private:
+    friend void* allocate_counted(size_t size, size_t alignment);
+    friend void free_counted(void* memory, bool aligned);
+
+    //Relaxed atomics, so other threads can read them (and threads past max_threads can share a slot)
+    struct Counter
+    {
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> frees = 0;
+    };
+
+    //A cache line of its own, so threads don't write to each other's lines
+    struct alignas(64) ThreadSlot
+    {
+        int worker = -1; //Pool worker index, -1 for threads outside the pools
+        std::array<Counter, max_sections + 1> sections; //Shifted by one, index 0 is no_section
+    };
+
+    static ThreadSlot& get_slot();
+    static Totals read(const Counter& counter);
+
+    static inline std::atomic<uint64_t> count = 0;
+    static inline std::atomic<bool> enabled = false;
+
+    static std::array<ThreadSlot, max_threads> slots;
+    static inline std::atomic<int> slots_used = 0;
+
+    static inline thread_local int current_section = no_section;
+    static inline thread_local int slot_index = -1;
+};
+
+} // namespace Tmpl8
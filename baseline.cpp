@@ -0,0 +1,150 @@
+#include "precomp.h"
+#include "baseline.h"
+
+namespace Tmpl8
+{
+
+//Samples per group up to which the exact distribution of U is used
+constexpr int max_exact_samples = 20;
+
+bool Baseline::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream stream(line);
+        std::string scenario, metric;
+        if (!(stream >> scenario >> metric)) continue;
+
+        vector<double> values;
+        double value;
+        while (stream >> value) values.push_back(value);
+        if (!values.empty()) samples[{ scenario, metric }] = std::move(values);
+    }
+    return true;
+}
+
+bool Baseline::save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "# Benchmark baseline, <scenario> <metric> <samples in ms>\n";
+    for (const auto& [key, values] : samples)
+    {
+        file << key.first << " " << key.second;
+        for (double value : values) file << " " << value;
+        file << "\n";
+    }
+    return true;
+}
+
+void Baseline::set(const std::string& scenario, const std::string& metric, vector<double> values)
+{
+    samples[{ scenario, metric }] = std::move(values);
+}
+
+const vector<double>* Baseline::find(const std::string& scenario, const std::string& metric) const
+{
+    const auto found = samples.find({ scenario, metric });
+    return (found != samples.end()) ? &found->second : nullptr;
+}
+
+double median(vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t count = values.size();
+    return (count % 2) ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) * 0.5;
+}
+
+// -----------------------------------------------------------
+// Probability of U >= u for groups of m and n samples without ties
+// Counts the orderings of both groups per value of U:
+// the largest value either comes from the first group (adding n to U) or from the second
+// -----------------------------------------------------------
+static double exact_upper_tail(int m, int n, int u)
+{
+    const int max_u = m * n;
+    vector<vector<vector<double>>> counts(m + 1, vector<vector<double>>(n + 1));
+    for (int i = 0; i <= m; i++)
+    {
+        for (int j = 0; j <= n; j++)
+        {
+            counts[i][j].assign(i * j + 1, 0.0);
+            if (i == 0 || j == 0)
+            {
+                counts[i][j][0] = 1.0;
+                continue;
+            }
+            for (int k = 0; k <= i * j; k++)
+            {
+                const double from_first = (k >= j && k - j <= (i - 1) * j) ? counts[i - 1][j][k - j] : 0.0;
+                const double from_second = (k <= i * (j - 1)) ? counts[i][j - 1][k] : 0.0;
+                counts[i][j][k] = from_first + from_second;
+            }
+        }
+    }
+
+    double total = 0.0, tail = 0.0;
+    for (int k = 0; k <= max_u; k++)
+    {
+        total += counts[m][n][k];
+        if (k >= u) tail += counts[m][n][k];
+    }
+    return tail / total;
+}
+
+double mann_whitney_greater(const vector<double>& samples, const vector<double>& baseline)
+{
+    const int m = (int)samples.size();
+    const int n = (int)baseline.size();
+    if (m == 0 || n == 0) return 1.0;
+
+    //Rank both groups together, tied values share their average rank
+    vector<std::pair<double, bool>> combined;
+    for (double value : samples) combined.push_back({ value, true });
+    for (double value : baseline) combined.push_back({ value, false });
+    std::sort(combined.begin(), combined.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const int total = m + n;
+    double rank_sum = 0.0;
+    double tie_correction = 0.0;
+    for (int i = 0; i < total;)
+    {
+        int end = i + 1;
+        while (end < total && combined[end].first == combined[i].first) end++;
+
+        const double rank = (i + 1 + end) * 0.5;
+        for (int k = i; k < end; k++)
+        {
+            if (combined[k].second) rank_sum += rank;
+        }
+
+        const double tied = end - i;
+        tie_correction += tied * tied * tied - tied;
+        i = end;
+    }
+
+    const double u = rank_sum - (m * (m + 1)) * 0.5;
+
+    if (tie_correction == 0.0 && m <= max_exact_samples && n <= max_exact_samples)
+    {
+        return exact_upper_tail(m, n, (int)std::lround(u));
+    }
+
+    const double mean = (m * n) * 0.5;
+    const double variance = ((double)m * n / 12.0) * ((total + 1) - tie_correction / ((double)total * (total - 1)));
+    if (variance <= 0.0) return 1.0;
+
+    //Continuity correction, U moves in steps of 0.5 with ties
+    const double z = (u - mean - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+} // namespace Tmpl8
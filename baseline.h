@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Written by "--benchmark --save-baseline", read by "--benchmark --baseline" and the game's speedup readout
+constexpr const char* default_baseline_path = "benchmark_baseline.txt";
+
+// -----------------------------------------------------------
+// Stored benchmark samples to compare new runs against.
+// Keeps the raw samples of every scenario and metric ("duration" and every phase),
+// one line per metric: "<scenario> <metric> <sample> <sample> ...".
+// Lines starting with '#' are comments, scenario names must not contain spaces.
+// -----------------------------------------------------------
+class Baseline
+{
+  public:
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    void set(const std::string& scenario, const std::string& metric, vector<double> samples);
+    //nullptr when the baseline has no samples for this scenario and metric
+    const vector<double>* find(const std::string& scenario, const std::string& metric) const;
+
+    bool empty() const { return samples.empty(); }
+
+  private:
+    //Ordered, so saved files are stable and diff nicely
+    std::map<std::pair<std::string, std::string>, vector<double>> samples;
+};
+
+// -----------------------------------------------------------
+// One sided Mann-Whitney U test, the probability of samples at least this much
+// larger than the baseline if both came from the same distribution.
+// Exact for small samples without ties, normal approximation (with tie correction) otherwise.
+// -----------------------------------------------------------
+double mann_whitney_greater(const vector<double>& samples, const vector<double>& baseline);
+
+double median(vector<double> values);
+
+} // namespace Tmpl8
@@ -0,0 +1,410 @@
+#include "precomp.h"
+#include "benchmark.h"
+
+namespace Tmpl8
+{
+
+static std::string trim(const std::string& text)
+{
+    const size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    const size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+//Split "key=value" into its trimmed parts
+static bool split_key_value(const std::string& text, std::string& key, std::string& value)
+{
+    const size_t separator = text.find('=');
+    if (separator == std::string::npos) return false;
+    key = trim(text.substr(0, separator));
+    value = trim(text.substr(separator + 1));
+    return !key.empty();
+}
+
+struct Statistics
+{
+    double mean, median, stddev, min, max;
+};
+
+static Statistics get_statistics(vector<double> values)
+{
+    Statistics statistics = {};
+    if (values.empty()) return statistics;
+
+    std::sort(values.begin(), values.end());
+    const size_t count = values.size();
+
+    double sum = 0.0;
+    for (double value : values) sum += value;
+    statistics.mean = sum / count;
+
+    double squares = 0.0;
+    for (double value : values) squares += (value - statistics.mean) * (value - statistics.mean);
+    statistics.stddev = (count > 1) ? sqrt(squares / (count - 1)) : 0.0;
+
+    statistics.median = (count % 2) ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) * 0.5;
+    statistics.min = values.front();
+    statistics.max = values.back();
+    return statistics;
+}
+
+bool BenchmarkRunner::parse_arguments(int argc, char** argv)
+{
+    bool requested = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        const bool has_value = (i + 1 < argc) && (argv[i + 1][0] != '-');
+
+        if (argument == "--benchmark")
+        {
+            requested = true;
+            if (has_value) config_path = argv[++i];
+        }
+        else if (argument == "--set" && has_value)
+        {
+            std::string key, value;
+            if (split_key_value(argv[++i], key, value)) overrides.push_back({ key, value });
+            else std::cout << "Ignoring --set " << argv[i] << ", expected key=value" << std::endl;
+        }
+        else if (argument == "--only" && has_value)
+        {
+            only = argv[++i];
+        }
+        else if (argument == "--out" && has_value)
+        {
+            results_path = argv[++i];
+        }
+        else if (argument == "--baseline")
+        {
+            baseline_path = has_value ? argv[++i] : default_baseline_path;
+        }
+        else if (argument == "--save-baseline")
+        {
+            save_baseline_path = has_value ? argv[++i] : default_baseline_path;
+        }
+        else if (argument == "--alpha" && has_value)
+        {
+            alpha = atof(argv[++i]);
+        }
+        else if (argument == "--threshold" && has_value)
+        {
+            threshold = atof(argv[++i]);
+        }
+    }
+    return requested;
+}
+
+bool BenchmarkRunner::apply(Scenario& scenario, const std::string& key, const std::string& value) const
+{
+    try
+    {
+        if (key == "name") scenario.name = value;
+        else if (key == "tanks_blue") scenario.tanks_blue = std::stoi(value);
+        else if (key == "tanks_red") scenario.tanks_red = std::stoi(value);
+        else if (key == "tanks") scenario.tanks_blue = scenario.tanks_red = std::stoi(value) / 2;
+        else if (key == "columns") scenario.columns = std::max(1, std::stoi(value));
+        else if (key == "spacing") scenario.spacing = std::stof(value);
+        else if (key == "map") scenario.map = value;
+        else if (key == "beams") scenario.beams = (value == "1" || value == "true" || value == "on");
+        else if (key == "rocket_speed") scenario.rocket_speed = std::stof(value);
+        else if (key == "swept_rockets") scenario.swept_rockets = (value == "1" || value == "true" || value == "on");
+        else if (key == "stable_order") scenario.stable_order = (value == "1" || value == "true" || value == "on");
+        else if (key == "frames") scenario.frames = std::stoi(value);
+        else if (key == "threads") scenario.threads = std::stoi(value);
+        else if (key == "repetitions") scenario.repetitions = std::max(1, std::stoi(value));
+        else if (key == "layout")
+        {
+            if (value == "grid") scenario.layout = SpawnLayout::GRID;
+            else if (value == "fit") scenario.layout = SpawnLayout::FIT;
+            else return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool BenchmarkRunner::load_scenarios(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not open benchmark config " << path << std::endl;
+        return false;
+    }
+
+    //Keys before the first section are defaults for every scenario
+    Scenario defaults;
+    Scenario* current = &defaults;
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); line_number++)
+    {
+        line = trim(line.substr(0, line.find_first_of("#;")));
+        if (line.empty()) continue;
+
+        if (line.front() == '[' && line.back() == ']')
+        {
+            scenarios.push_back(defaults);
+            scenarios.back().name = trim(line.substr(1, line.size() - 2));
+            current = &scenarios.back();
+            continue;
+        }
+
+        std::string key, value;
+        if (!split_key_value(line, key, value) || !apply(*current, key, value))
+        {
+            std::cout << path << ":" << line_number << ": invalid line \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int BenchmarkRunner::run()
+{
+    if (config_path.empty() && overrides.empty()) config_path = "benchmark.ini";
+
+    //Load the baseline first, so a typo doesn't cost a whole benchmark run
+    Baseline baseline;
+    if (!baseline_path.empty() && !baseline.load(baseline_path))
+    {
+        std::cout << "Could not read baseline " << baseline_path << std::endl;
+        return 2;
+    }
+
+    if (!config_path.empty())
+    {
+        if (!load_scenarios(config_path)) return 2;
+    }
+    else
+    {
+        Scenario scenario;
+        scenario.name = "cli";
+        scenarios.push_back(scenario);
+    }
+
+    for (Scenario& scenario : scenarios)
+    {
+        for (const auto& [key, value] : overrides)
+        {
+            if (!apply(scenario, key, value))
+            {
+                std::cout << "Invalid --set " << key << "=" << value << std::endl;
+                return 2;
+            }
+        }
+    }
+
+    //The game still draws every frame, into a surface that is never shown
+    Surface screen(SCRWIDTH, SCRHEIGHT);
+
+    Results results;
+    for (const Scenario& scenario : scenarios)
+    {
+        if (!only.empty() && scenario.name != only) continue;
+
+        std::cout << "Scenario " << scenario.name << ": " << scenario.tanks_blue << " + " << scenario.tanks_red << " tanks, "
+                  << scenario.frames << " frames, " << scenario.repetitions << " repetitions" << std::endl;
+
+        set_thread_count(scenario.threads);
+
+        vector<RunResult> runs;
+        for (int repetition = 0; repetition < scenario.repetitions; repetition++)
+        {
+            runs.push_back(run_once(scenario, &screen));
+            std::cout << "  run " << (repetition + 1) << ": " << runs.back().duration << " ms, " << runs.back().steady_allocations << " heap allocations in the second half" << std::endl;
+        }
+
+        //Report the thread count that was actually used, 0 means the default
+        Scenario used = scenario;
+        used.threads = num_threads;
+        results.push_back({ used, std::move(runs) });
+    }
+
+    set_thread_count(0);
+
+    if (results.empty())
+    {
+        std::cout << "No scenarios to run" << std::endl;
+        return 2;
+    }
+    if (!write_results(results)) return 2;
+
+    if (!save_baseline_path.empty())
+    {
+        if (!to_baseline(results).save(save_baseline_path))
+        {
+            std::cout << "Could not write baseline " << save_baseline_path << std::endl;
+            return 2;
+        }
+        std::cout << "Baseline written to " << save_baseline_path << std::endl;
+    }
+
+    if (!baseline_path.empty() && compare(results, baseline) > 0) return 1;
+    return 0;
+}
+
+BenchmarkRunner::RunResult BenchmarkRunner::run_once(const Scenario& scenario, Surface* screen) const
+{
+    std::unique_ptr<Game> game = std::make_unique<Game>(scenario);
+    game->set_target(screen);
+    game->init();
+
+    uint64_t allocations_start = AllocationTracker::get_count();
+    for (int frame = 0; !game->is_finished(); frame++)
+    {
+        if (frame == scenario.frames / 2) allocations_start = AllocationTracker::get_count();
+        game->tick(0.f);
+    }
+
+    std::array<AllocationTracker::Totals, (int)Phase::COUNT> phase_allocations;
+    for (int p = 0; p < (int)Phase::COUNT; p++) phase_allocations[p] = AllocationTracker::get_section_total(p);
+
+    RunResult result = { game->get_duration(), game->get_phase_totals(), game->get_tank_count(), AllocationTracker::get_count() - allocations_start,
+                         phase_allocations, AllocationTracker::get_total() };
+    game->shutdown();
+    return result;
+}
+
+bool BenchmarkRunner::write_results(const Results& results) const
+{
+    std::ofstream file(results_path);
+    if (!file)
+    {
+        std::cout << "Could not write benchmark results to " << results_path << std::endl;
+        return false;
+    }
+
+    file << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"scenarios\": [\n";
+    for (size_t s = 0; s < results.size(); s++)
+    {
+        const Scenario& scenario = results[s].first;
+        const vector<RunResult>& runs = results[s].second;
+
+        file << "    {\n      \"name\": \"" << scenario.name << "\",\n"
+             << "      \"tanks_blue\": " << scenario.tanks_blue << ", \"tanks_red\": " << scenario.tanks_red << ",\n"
+             << "      \"layout\": \"" << ((scenario.layout == SpawnLayout::GRID) ? "grid" : "fit") << "\", \"map\": \"" << scenario.map << "\", \"beams\": " << (scenario.beams ? "true" : "false")
+             << ", \"stable_order\": " << (scenario.stable_order ? "true" : "false") << ",\n"
+             << "      \"rocket_speed\": " << scenario.rocket_speed << ", \"swept_rockets\": " << (scenario.swept_rockets ? "true" : "false") << ",\n"
+             << "      \"frames\": " << scenario.frames << ", \"threads\": " << scenario.threads << ",\n";
+
+        //Raw samples, so other tools can run their own statistics
+        vector<double> durations;
+        file << "      \"runs\": [\n";
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            durations.push_back(runs[r].duration);
+            file << "        { \"duration_ms\": " << runs[r].duration << ", \"tanks_left\": " << runs[r].tanks_left << ", \"steady_allocations\": " << runs[r].steady_allocations << ", \"phases_ms\": {";
+            for (int p = 0; p < (int)Phase::COUNT; p++)
+            {
+                file << (p ? ", " : " ") << "\"" << phase_names[p] << "\": " << runs[r].phase_totals[p];
+            }
+            file << " }";
+            if (AllocationTracker::is_enabled())
+            {
+                file << ",\n          \"allocations\": { \"count\": " << runs[r].allocations.allocations << ", \"bytes\": " << runs[r].allocations.bytes << ", \"frees\": " << runs[r].allocations.frees << ", \"phases\": {";
+                for (int p = 0; p < (int)Phase::COUNT; p++)
+                {
+                    const AllocationTracker::Totals& phase = runs[r].phase_allocations[p];
+                    file << (p ? ", " : " ") << "\"" << phase_names[p] << "\": { \"count\": " << phase.allocations << ", \"bytes\": " << phase.bytes << " }";
+                }
+                file << " } }";
+            }
+            file << " }" << ((r + 1 < runs.size()) ? "," : "") << "\n";
+        }
+        file << "      ],\n";
+
+        const Statistics statistics = get_statistics(durations);
+        file << "      \"duration_ms\": { \"mean\": " << statistics.mean << ", \"median\": " << statistics.median << ", \"stddev\": " << statistics.stddev
+             << ", \"min\": " << statistics.min << ", \"max\": " << statistics.max << " }\n";
+        file << "    }" << ((s + 1 < results.size()) ? "," : "") << "\n";
+
+        std::cout << scenario.name << ": median " << statistics.median << " ms, mean " << statistics.mean << " ms, stddev " << statistics.stddev << " ms" << std::endl;
+    }
+    file << "  ]\n}\n";
+
+    std::cout << "Benchmark results written to " << results_path << std::endl;
+    return true;
+}
+
+vector<std::pair<std::string, vector<double>>> BenchmarkRunner::get_metrics(const vector<RunResult>& runs)
+{
+    vector<std::pair<std::string, vector<double>>> metrics(1 + (int)Phase::COUNT);
+    metrics[0].first = "duration";
+    for (int p = 0; p < (int)Phase::COUNT; p++) metrics[1 + p].first = phase_names[p];
+
+    for (const RunResult& run : runs)
+    {
+        metrics[0].second.push_back(run.duration);
+        for (int p = 0; p < (int)Phase::COUNT; p++) metrics[1 + p].second.push_back(run.phase_totals[p]);
+    }
+    return metrics;
+}
+
+Baseline BenchmarkRunner::to_baseline(const Results& results) const
+{
+    Baseline baseline;
+    for (const auto& [scenario, runs] : results)
+    {
+        for (auto& [metric, samples] : get_metrics(runs)) baseline.set(scenario.name, metric, std::move(samples));
+    }
+    return baseline;
+}
+
+// -----------------------------------------------------------
+// Report every metric whose samples are significantly larger than the baseline's
+// Tiny phases are noisy in relative terms, so the median also has to grow by
+// at least threshold percent and min_regression_ms
+// -----------------------------------------------------------
+int BenchmarkRunner::compare(const Results& results, const Baseline& baseline) const
+{
+    constexpr double min_regression_ms = 1.0;
+
+    int regressions = 0;
+    std::cout << "Comparing against " << baseline_path << " (alpha " << alpha << ", threshold " << threshold << "%)" << std::endl;
+
+    for (const auto& [scenario, runs] : results)
+    {
+        for (const auto& [metric, samples] : get_metrics(runs))
+        {
+            const vector<double>* reference = baseline.find(scenario.name, metric);
+            if (!reference)
+            {
+                if (metric == "duration") std::cout << "  " << scenario.name << ": no baseline" << std::endl;
+                continue;
+            }
+
+            const double current_median = median(samples);
+            const double reference_median = median(*reference);
+            const double change = (reference_median > 0.0) ? ((current_median / reference_median) - 1.0) * 100.0 : 0.0;
+
+            const double p_slower = mann_whitney_greater(samples, *reference);
+            const double p_faster = mann_whitney_greater(*reference, samples);
+
+            const bool regressed = (p_slower < alpha) && (change >= threshold) && (current_median - reference_median >= min_regression_ms);
+            const bool improved = (p_faster < alpha) && (-change >= threshold) && (reference_median - current_median >= min_regression_ms);
+            if (!regressed && !improved && metric != "duration") continue;
+
+            char line[192];
+            sprintf(line, "  %-20s %-10s %10.1f ms -> %10.1f ms  %+6.1f%%  p=%.4f  %s", scenario.name.c_str(), metric.c_str(), reference_median, current_median, change,
+                    regressed ? p_slower : p_faster, regressed ? "REGRESSION" : (improved ? "faster" : "unchanged"));
+            std::cout << line << std::endl;
+
+            if (regressed) regressions++;
+        }
+    }
+
+    std::cout << regressions << " regression(s)" << std::endl;
+    return regressions;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,81 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Headless benchmark runner.
+// Runs every scenario of a config file (or one scenario built from the command line)
+// a number of times without opening a window, and writes the timings as JSON.
+//
+//   --benchmark [file]   run the scenarios in file (benchmark.ini when omitted)
+//   --set key=value      override a scenario key for every scenario, may be repeated
+//   --only name          only run the scenario with this name
+//   --out file           results file (benchmark_results.json when omitted)
+//   --save-baseline [file]  store the samples as the new baseline (benchmark_baseline.txt when omitted)
+//   --baseline [file]    compare against a stored baseline, the exit code is 1 when anything regressed
+//   --alpha p            significance level of the regression test (0.01 when omitted)
+//   --threshold percent  smallest slowdown of the median that counts as a regression (3 when omitted)
+//
+// Every run also counts the heap allocations of its second half of frames, once routes,
+// spawning and the frame arenas have settled these should be zero.
+// With --allocations the allocations and bytes of every phase are tracked as well,
+// printed after every run and written to the results.
+//
+// Every scenario's duration and phase totals are compared with a one sided Mann-Whitney U
+// test over the repetitions, so a regression needs enough repetitions to be significant
+// (with 5 runs on both sides at most one pair may be out of order at alpha 0.01).
+//
+// The config file is ini-like: "[name]" starts a scenario, followed by "key = value"
+// lines with the keys of Scenario (tanks_blue, tanks_red, layout, columns, spacing,
+// map, beams, rocket_speed, swept_rockets, stable_order, frames, threads, repetitions). Keys before the first section apply to all scenarios.
+// -----------------------------------------------------------
+class BenchmarkRunner
+{
+  public:
+    //Returns false when --benchmark isn't on the command line
+    bool parse_arguments(int argc, char** argv);
+
+    //Runs everything, returns the exit code for the process
+    int run();
+
+  private:
+    struct RunResult
+    {
+        float duration;
+        std::array<double, (int)Phase::COUNT> phase_totals;
+        int tanks_left;
+        uint64_t steady_allocations; //Heap allocations in the second half of the frames
+        //Only with --allocations, every frame of the run
+        std::array<AllocationTracker::Totals, (int)Phase::COUNT> phase_allocations;
+        AllocationTracker::Totals allocations;
+    };
+
+    bool load_scenarios(const std::string& path);
+    bool apply(Scenario& scenario, const std::string& key, const std::string& value) const;
+
+    using Results = vector<std::pair<Scenario, vector<RunResult>>>;
+
+    RunResult run_once(const Scenario& scenario, Surface* screen) const;
+    bool write_results(const Results& results) const;
+
+    //Every metric of a scenario as one list of samples, "duration" and the phase names
+    static vector<std::pair<std::string, vector<double>>> get_metrics(const vector<RunResult>& runs);
+    Baseline to_baseline(const Results& results) const;
+    //Returns the number of regressions
+    int compare(const Results& results, const Baseline& baseline) const;
+
+    std::string config_path;
+    std::string results_path = "benchmark_results.json";
+    std::string only;
+    vector<std::pair<std::string, std::string>> overrides;
+
+    std::string baseline_path;
+    std::string save_baseline_path;
+    double alpha = 0.01;
+    double threshold = 3.0;
+
+    vector<Scenario> scenarios;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,56 @@
+#include "precomp.h"
+#include "camera.h"
+
+namespace Tmpl8
+{
+
+Camera::Camera(int viewport_x, int viewport_y, int viewport_width, int viewport_height, vec2 world_size)
+    : viewport_x(viewport_x), viewport_y(viewport_y), viewport_width(viewport_width), viewport_height(viewport_height), world_size(world_size)
+{
+    reset();
+}
+
+void Camera::pan(vec2 screen_delta)
+{
+    position += screen_delta / zoom;
+    clamp_to_world();
+}
+
+void Camera::zoom_at(float factor, vec2 screen)
+{
+    const vec2 anchor = screen_to_world(screen);
+    zoom = clamp(zoom * factor, min_zoom, max_zoom);
+
+    //Move the view so the anchor stays under the same screen position
+    position = anchor - (screen - vec2((float)viewport_x, (float)viewport_y)) / zoom;
+    clamp_to_world();
+}
+
+void Camera::reset()
+{
+    position = vec2(0.f);
+    zoom = 1.f;
+    clamp_to_world();
+}
+
+void Camera::clamp_to_world()
+{
+    const vec2 view_size = vec2((float)viewport_width, (float)viewport_height) / zoom;
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (view_size.cell[axis] >= world_size.cell[axis])
+        {
+            position.cell[axis] = (world_size.cell[axis] - view_size.cell[axis]) * 0.5f;
+        }
+        else
+        {
+            position.cell[axis] = clamp(position.cell[axis], 0.f, world_size.cell[axis] - view_size.cell[axis]);
+        }
+    }
+
+    view_min = position;
+    view_max = position + view_size;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Pan and zoom view on the world.
+// The world is drawn into a viewport rectangle on the screen (between the health bars),
+// world position "position" ends up in the top left corner of the viewport.
+// With the default position and a zoom of 1 the world maps 1:1 onto the viewport.
+// -----------------------------------------------------------
+class Camera
+{
+  public:
+    static constexpr float min_zoom = 0.25f;
+    static constexpr float max_zoom = 4.f;
+
+    Camera() = default;
+    Camera(int viewport_x, int viewport_y, int viewport_width, int viewport_height, vec2 world_size);
+
+    vec2 world_to_screen(vec2 world) const { return vec2((float)viewport_x, (float)viewport_y) + (world - position) * zoom; }
+    vec2 screen_to_world(vec2 screen) const { return position + (screen - vec2((float)viewport_x, (float)viewport_y)) / zoom; }
+
+    //Is the world space rectangle (at least partially) inside the viewport?
+    bool is_visible(vec2 world_min, vec2 world_max) const
+    {
+        return world_max.x >= view_min.x && world_min.x <= view_max.x && world_max.y >= view_min.y && world_min.y <= view_max.y;
+    }
+
+    //Move the view by the given amount of screen pixels
+    void pan(vec2 screen_delta);
+    //Multiply the zoom by factor, keeping the world position under the given screen position in place
+    void zoom_at(float factor, vec2 screen);
+    void reset();
+
+    vec2 get_position() const { return position; }
+    float get_zoom() const { return zoom; }
+
+    //World space rectangle covered by the viewport
+    vec2 get_view_min() const { return view_min; }
+    vec2 get_view_max() const { return view_max; }
+
+    int get_viewport_x() const { return viewport_x; }
+    int get_viewport_y() const { return viewport_y; }
+    int get_viewport_width() const { return viewport_width; }
+    int get_viewport_height() const { return viewport_height; }
+
+  private:
+    //Keep the view inside the world, a world smaller than the view is centered
+    void clamp_to_world();
+
+    vec2 position = vec2(0.f);
+    float zoom = 1.f;
+
+    vec2 view_min = vec2(0.f);
+    vec2 view_max = vec2(0.f);
+
+    int viewport_x = 0;
+    int viewport_y = 0;
+    int viewport_width = 0;
+    int viewport_height = 0;
+
+    vec2 world_size = vec2(0.f);
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,62 @@
+#include "precomp.h"
+#include "density_buffer.h"
+
+namespace Tmpl8
+{
+
+//Cells with this many units or more get the brightest splat
+constexpr int splat_saturation = 16;
+
+void DensityBuffer::reset(const Camera& camera)
+{
+    this->camera = camera;
+    cells_x = (camera.get_viewport_width() + cell_size - 1) / cell_size;
+    cells_y = (camera.get_viewport_height() + cell_size - 1) / cell_size;
+
+    counts.assign((size_t)cells_x * cells_y, { 0, 0 });
+}
+
+int DensityBuffer::cell_of(vec2 position) const
+{
+    const vec2 screen = camera.world_to_screen(position);
+    const int x = (int)floorf(screen.x) - camera.get_viewport_x();
+    const int y = (int)floorf(screen.y) - camera.get_viewport_y();
+    if (x < 0 || y < 0 || x >= camera.get_viewport_width() || y >= camera.get_viewport_height()) return -1;
+
+    return (x / cell_size) + (y / cell_size) * cells_x;
+}
+
+void DensityBuffer::add(int cell, int team)
+{
+    if (cell < 0) return;
+
+    uint16_t& count = counts[cell][team];
+    if (count < UINT16_MAX) count++;
+}
+
+void DensityBuffer::draw_splats(DrawList& draw_list, int threshold) const
+{
+    const int viewport_x2 = camera.get_viewport_x() + camera.get_viewport_width() - 1;
+    const int viewport_y2 = camera.get_viewport_y() + camera.get_viewport_height() - 1;
+
+    for (int cell_y = 0; cell_y < cells_y; cell_y++)
+    {
+        for (int cell_x = 0; cell_x < cells_x; cell_x++)
+        {
+            const int cell = cell_x + cell_y * cells_x;
+            const int count = total(cell);
+            if (count == 0 || count < threshold) continue;
+
+            //Red and blue in proportion to the teams, brighter when more units share the cell
+            const int intensity = 128 + (127 * std::min(count, splat_saturation)) / splat_saturation;
+            const Pixel red = (Pixel)((counts[cell][RED] * intensity) / count);
+            const Pixel blue = (Pixel)((counts[cell][BLUE] * intensity) / count);
+
+            const int x1 = camera.get_viewport_x() + cell_x * cell_size;
+            const int y1 = camera.get_viewport_y() + cell_y * cell_size;
+            draw_list.draw_bar(x1, y1, std::min(x1 + cell_size - 1, viewport_x2), std::min(y1 + cell_size - 1, viewport_y2), (red << 16) | blue);
+        }
+    }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Per team unit counts for a grid of screen cells covering the camera's viewport.
+// Used for level of detail: cells with many overlapping tanks are drawn as a
+// single coloured splat instead of a sprite per tank, so drawing cost follows
+// the number of covered cells instead of the number of tanks.
+// -----------------------------------------------------------
+class DensityBuffer
+{
+  public:
+    static constexpr int cell_size = 8; //Screen pixels
+
+    //Size the grid for the camera's viewport and clear all counts
+    void reset(const Camera& camera);
+
+    //Cell under the given world position, -1 when it is outside the viewport
+    int cell_of(vec2 position) const;
+    void add(int cell, int team);
+
+    bool is_dense(int cell, int threshold) const { return cell >= 0 && total(cell) >= threshold; }
+
+    //Draw a bar for every cell with at least threshold units, coloured by the teams in it
+    void draw_splats(DrawList& draw_list, int threshold) const;
+
+  private:
+    int total(int cell) const { return counts[cell][0] + counts[cell][1]; }
+
+    Camera camera;
+    int cells_x = 0;
+    int cells_y = 0;
+
+    //Units per team (indexed by allignment) for every cell
+    vector<std::array<uint16_t, 2>> counts;
+};
+
+} // namespace Tmpl8
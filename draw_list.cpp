@@ -0,0 +1,113 @@
+#include "precomp.h"
+#include "draw_list.h"
+
+namespace Tmpl8
+{
+
+void DrawList::draw_sprite(Sprite* sprite, unsigned int frame, int x, int y, unsigned int flags)
+{
+    DrawCommand command;
+    command.type = DrawCommandType::SPRITE;
+    command.flags = (uint16_t)flags;
+    command.sprite = (uint16_t)sprite->get_id();
+    command.frame = frame;
+    command.x1 = (float)x;
+    command.y1 = (float)y;
+    command.x2 = (float)(x + sprite->get_width() - 1);
+    command.y2 = (float)(y + sprite->get_height() - 1);
+    commands.push_back(command);
+}
+
+void DrawList::draw_world_sprite(Sprite* sprite, unsigned int frame, vec2 position, int offset_x, int offset_y, unsigned int flags)
+{
+    const float zoom = camera.get_zoom();
+    const vec2 view = (position - camera.get_position()) * zoom;
+
+    const int x = camera.get_viewport_x() + (int)floorf(view.x) + (int)floorf(offset_x * zoom);
+    const int y = camera.get_viewport_y() + (int)floorf(view.y) + (int)floorf(offset_y * zoom);
+    const int width = std::max(1, (int)(sprite->get_width() * zoom + 0.5f));
+    const int height = std::max(1, (int)(sprite->get_height() * zoom + 0.5f));
+
+    //Cull against the viewport
+    if (x + width <= camera.get_viewport_x() || x >= camera.get_viewport_x() + camera.get_viewport_width()) return;
+    if (y + height <= camera.get_viewport_y() || y >= camera.get_viewport_y() + camera.get_viewport_height()) return;
+
+    DrawCommand command;
+    command.type = DrawCommandType::SPRITE;
+    command.flags = (uint16_t)flags;
+    command.sprite = (uint16_t)sprite->get_id();
+    command.frame = frame;
+    command.x1 = (float)x;
+    command.y1 = (float)y;
+    command.x2 = (float)(x + width - 1);
+    command.y2 = (float)(y + height - 1);
+    commands.push_back(command);
+}
+
+void DrawList::draw_line(vec2 start, vec2 end, Pixel color)
+{
+    DrawCommand command;
+    command.type = DrawCommandType::LINE;
+    command.flags = 0;
+    command.sprite = 0;
+    command.color = color;
+    command.x1 = start.x;
+    command.y1 = start.y;
+    command.x2 = end.x;
+    command.y2 = end.y;
+    commands.push_back(command);
+}
+
+void DrawList::draw_bar(int x1, int y1, int x2, int y2, Pixel color)
+{
+    DrawCommand command;
+    command.type = DrawCommandType::BAR;
+    command.flags = 0;
+    command.sprite = 0;
+    command.color = color;
+    command.x1 = (float)x1;
+    command.y1 = (float)y1;
+    command.x2 = (float)x2;
+    command.y2 = (float)y2;
+    commands.push_back(command);
+}
+
+void DrawList::draw_shade(int x1, int y1, int x2, int y2, unsigned int scale)
+{
+    DrawCommand command;
+    command.type = DrawCommandType::SHADE;
+    command.flags = 0;
+    command.sprite = 0;
+    command.frame = scale;
+    command.x1 = (float)x1;
+    command.y1 = (float)y1;
+    command.x2 = (float)x2;
+    command.y2 = (float)y2;
+    commands.push_back(command);
+}
+
+void DrawList::draw_glyphs(Font* font, const vector<Font::Glyph>& glyphs)
+{
+    for (const Font::Glyph& glyph : glyphs)
+    {
+        DrawCommand command;
+        command.type = DrawCommandType::GLYPH;
+        command.flags = 0;
+        command.sprite = (uint16_t)font->get_id();
+        command.frame = (uint32_t)glyph.index;
+        command.x1 = (float)glyph.x;
+        command.y1 = (float)glyph.y;
+        command.x2 = (float)(glyph.x + font->glyph_width(glyph.index) - 1);
+        command.y2 = (float)(glyph.y + font->height() - 1);
+        commands.push_back(command);
+    }
+}
+
+void DrawList::draw_text(Font* font, const char* text, int x, int y)
+{
+    text_glyphs.clear();
+    font->layout(text, x, y, text_glyphs);
+    draw_glyphs(font, text_glyphs);
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace Tmpl8
+{
+//Kinds of draw calls the tile renderer knows how to rasterise
+enum class DrawCommandType : uint8_t
+{
+    SPRITE,
+    LINE,
+    BAR,
+    SHADE,
+    GLYPH
+};
+
+//A single recorded draw call, kept small because there is one per visible entity per frame
+//Sprites and glyphs use (x1, y1) as their top left corner and (x2, y2) as their bottom right corner (scaled when zoomed),
+//bars and shades use both corners (inclusive) and lines use both end points
+struct DrawCommand
+{
+    DrawCommandType type;
+    uint16_t flags; //Sprite flags (e.g. Sprite::FLARE) added to the sprite's own flags, NOCLIP is bit 14
+    uint16_t sprite; //Font id for glyphs
+    union
+    {
+        uint32_t frame; //Glyph index for glyphs, scale for shades
+        Pixel color;
+    };
+    float x1, y1, x2, y2;
+};
+
+// -----------------------------------------------------------
+// Command buffer filled by the simulation and consumed by the renderer
+// Holds no pointers into the game state, so it can be rendered while
+// the next frame is being simulated
+// -----------------------------------------------------------
+class DrawList
+{
+  public:
+    void clear() { commands.clear(); }
+
+    //View used for the world space draw calls, the renderer also uses it to draw the background
+    void set_camera(const Camera& camera) { this->camera = camera; }
+    const Camera& get_camera() const { return camera; }
+
+    //Screen space sprite
+    void draw_sprite(Sprite* sprite, unsigned int frame, int x, int y, unsigned int flags = 0);
+    //World space sprite, (offset_x, offset_y) is the unscaled offset from position to the sprite's top left corner
+    //Sprites outside the camera's viewport are culled and no command is recorded
+    void draw_world_sprite(Sprite* sprite, unsigned int frame, vec2 position, int offset_x, int offset_y, unsigned int flags = 0);
+    void draw_line(vec2 start, vec2 end, Pixel color);
+    void draw_bar(int x1, int y1, int x2, int y2, Pixel color);
+    //Multiply the colors below the rectangle by scale, 5.5 fixed point (see surface_ops::scale_color)
+    void draw_shade(int x1, int y1, int x2, int y2, unsigned int scale);
+    //Screen space text, added to the colors below it like Font::print
+    void draw_glyphs(Font* font, const vector<Font::Glyph>& glyphs);
+    void draw_text(Font* font, const char* text, int x, int y);
+
+    const vector<DrawCommand>& get_commands() const { return commands; }
+
+  private:
+    vector<DrawCommand> commands;
+    Camera camera;
+    vector<Font::Glyph> text_glyphs; //Reused by draw_text
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,145 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Handle to an entity in an EntityPool
+// The generation makes handles to despawned entities invalid, even when their slot is reused
+// -----------------------------------------------------------
+struct EntityHandle
+{
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+
+    bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+// -----------------------------------------------------------
+// Slot map: entities live densely packed for iteration, handles go through
+// a slot table so they stay valid while entities around them come and go.
+// Spawning takes a slot from the free list, despawning moves only the last
+// entity into the hole, so both are O(1) and no other entity moves.
+// Not thread safe, spawning from several threads needs a lock (and a reserve
+// when other threads iterate at the same time, so the entities aren't reallocated).
+// -----------------------------------------------------------
+template <typename T>
+class EntityPool
+{
+  public:
+    template <typename... Args>
+    EntityHandle spawn(Args&&... args)
+    {
+        uint32_t slot_index;
+        if (free_head != no_slot)
+        {
+            slot_index = free_head;
+            free_head = slots[slot_index].dense_index;
+        }
+        else
+        {
+            slot_index = (uint32_t)slots.size();
+            slots.push_back({ 0, 0 });
+        }
+
+        Slot& slot = slots[slot_index];
+        slot.dense_index = (uint32_t)entities.size();
+        entities.emplace_back(std::forward<Args>(args)...);
+        dense_to_slot.push_back(slot_index);
+
+        return { slot_index, slot.generation };
+    }
+
+    void despawn(EntityHandle handle)
+    {
+        if (contains(handle)) despawn_at(slots[handle.index].dense_index);
+    }
+
+    //Despawns every entity the predicate returns true for, the survivors keep their handles
+    template <typename Predicate>
+    void despawn_if(Predicate predicate)
+    {
+        for (size_t i = 0; i < entities.size();)
+        {
+            if (predicate(entities[i])) despawn_at((uint32_t)i);
+            else i++;
+        }
+    }
+
+    bool contains(EntityHandle handle) const
+    {
+        //Despawning bumps the generation, so a free slot never matches a handle
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+    }
+
+    //nullptr when the entity was despawned
+    T* get(EntityHandle handle) { return contains(handle) ? &entities[slots[handle.index].dense_index] : nullptr; }
+
+    //Handle of the entity at a position of the dense iteration order
+    EntityHandle handle_at(size_t dense_index) const
+    {
+        const uint32_t slot_index = dense_to_slot[dense_index];
+        return { slot_index, slots[slot_index].generation };
+    }
+
+    void reserve(size_t count)
+    {
+        entities.reserve(count);
+        dense_to_slot.reserve(count);
+        slots.reserve(count);
+    }
+
+    void clear()
+    {
+        for (size_t i = entities.size(); i > 0; i--) despawn_at((uint32_t)(i - 1));
+    }
+
+    //Dense iteration, the order changes when entities are despawned
+    T& operator[](size_t dense_index) { return entities[dense_index]; }
+    const T& operator[](size_t dense_index) const { return entities[dense_index]; }
+    typename vector<T>::iterator begin() { return entities.begin(); }
+    typename vector<T>::iterator end() { return entities.end(); }
+    typename vector<T>::const_iterator begin() const { return entities.begin(); }
+    typename vector<T>::const_iterator end() const { return entities.end(); }
+
+    size_t size() const { return entities.size(); }
+    size_t capacity() const { return entities.capacity(); }
+    bool empty() const { return entities.empty(); }
+
+  private:
+    static constexpr uint32_t no_slot = std::numeric_limits<uint32_t>::max();
+
+    struct Slot
+    {
+        uint32_t dense_index; //Next free slot while the slot is on the free list
+        uint32_t generation;
+    };
+
+    void despawn_at(uint32_t dense_index)
+    {
+        const uint32_t slot_index = dense_to_slot[dense_index];
+        const uint32_t last = (uint32_t)entities.size() - 1;
+
+        if (dense_index != last)
+        {
+            entities[dense_index] = std::move(entities[last]);
+            dense_to_slot[dense_index] = dense_to_slot[last];
+            slots[dense_to_slot[dense_index]].dense_index = dense_index;
+        }
+        entities.pop_back();
+        dense_to_slot.pop_back();
+
+        Slot& slot = slots[slot_index];
+        slot.generation++;
+        slot.dense_index = free_head;
+        free_head = slot_index;
+    }
+
+    vector<T> entities;
+    vector<uint32_t> dense_to_slot;
+    vector<Slot> slots;
+    uint32_t free_head = no_slot;
+};
+
+} // namespace Tmpl8
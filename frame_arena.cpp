@@ -0,0 +1,101 @@
+#include "precomp.h"
+#include "frame_arena.h"
+
+namespace Tmpl8
+{
+
+//Every live arena, so the frame boundary can rewind the ones of other threads
+static std::mutex arenas_mutex;
+static vector<FrameArena*> arenas;
+
+FrameArena::FrameArena()
+{
+    std::lock_guard<std::mutex> lock(arenas_mutex);
+    arenas.push_back(this);
+}
+
+FrameArena::~FrameArena()
+{
+    {
+        std::lock_guard<std::mutex> lock(arenas_mutex);
+        arenas.erase(std::remove(arenas.begin(), arenas.end(), this), arenas.end());
+    }
+    free_chunks();
+}
+
+FrameArena& FrameArena::get()
+{
+    //Destroyed when the thread exits, so pools that are replaced don't leak their workers' arenas
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+void FrameArena::reset_all()
+{
+    std::lock_guard<std::mutex> lock(arenas_mutex);
+    for (FrameArena* arena : arenas) arena->reset();
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    //Try the current chunk, then the ones after it that are still around from earlier frames
+    for (; current_chunk < chunks.size(); current_chunk++, offset = 0)
+    {
+        const Chunk& chunk = chunks[current_chunk];
+        //Align the address, chunks only have the default alignment of operator new
+        const uintptr_t address = (uintptr_t)(chunk.data + offset);
+        const size_t start = offset + (size_t)(((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+        if (start + bytes <= chunk.size)
+        {
+            offset = start + bytes;
+            return chunk.data + start;
+        }
+    }
+
+    //Chunks double in size, so a frame that needs a lot of memory only takes a few of them
+    const size_t size = std::max(std::max(initial_chunk_size, chunks.empty() ? 0 : chunks.back().size * 2), bytes + alignment);
+    chunks.push_back({ static_cast<char*>(::operator new(size)), size });
+    current_chunk = chunks.size() - 1;
+
+    char* data = chunks.back().data;
+    const size_t start = ((uintptr_t)data % alignment) ? alignment - ((uintptr_t)data % alignment) : 0;
+    offset = start + bytes;
+    return data + start;
+}
+
+void FrameArena::reset()
+{
+    //Replace several chunks by one that holds all of them, the next frame most likely needs as much
+    if (chunks.size() > 1)
+    {
+        size_t size = 0;
+        for (const Chunk& chunk : chunks) size += chunk.size;
+
+        free_chunks();
+        chunks.push_back({ static_cast<char*>(::operator new(size)), size });
+    }
+    current_chunk = 0;
+    offset = 0;
+}
+
+void FrameArena::free_chunks()
+{
+    for (const Chunk& chunk : chunks) ::operator delete(chunk.data);
+    chunks.clear();
+}
+
+size_t FrameArena::get_used() const
+{
+    size_t used = offset;
+    for (size_t i = 0; i < current_chunk && i < chunks.size(); i++) used += chunks[i].size;
+    return used;
+}
+
+size_t FrameArena::get_capacity() const
+{
+    size_t capacity = 0;
+    for (const Chunk& chunk : chunks) capacity += chunk.size;
+    return capacity;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,85 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Per-thread bump allocator for temporaries that don't outlive the frame.
+// Every thread gets its own arena on first use, so allocating never locks.
+// Freeing does nothing, all memory is handed back at once by reset_all at the
+// frame boundary, which keeps the chunks so a steady frame never calls the heap.
+// When a frame needed more than one chunk they are merged into one on reset.
+//
+// Use it through the std::pmr containers:
+//   frame_vector<int> values(&FrameArena::get());
+// -----------------------------------------------------------
+class FrameArena : public std::pmr::memory_resource
+{
+  public:
+    FrameArena();
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    //The calling thread's arena
+    static FrameArena& get();
+
+    //Rewinds every thread's arena, only call while no thread uses its arena
+    //(and every task that allocated from one has been waited for)
+    static void reset_all();
+
+    // -----------------------------------------------------------
+    // Hands back everything allocated from the arena since the scope started,
+    // for temporaries of calls that run many times within a frame.
+    // Don't enqueue pool tasks inside a scope, their state lives in the arena too.
+    // -----------------------------------------------------------
+    class Scope
+    {
+      public:
+        explicit Scope(FrameArena& arena = get()) : arena(arena), chunk(arena.current_chunk), offset(arena.offset) {}
+        ~Scope()
+        {
+            arena.current_chunk = chunk;
+            arena.offset = offset;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+      private:
+        FrameArena& arena;
+        size_t chunk;
+        size_t offset;
+    };
+
+    //Bytes in use, and reserved in all chunks
+    size_t get_used() const;
+    size_t get_capacity() const;
+
+  protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+  private:
+    static constexpr size_t initial_chunk_size = 64 * 1024;
+
+    struct Chunk
+    {
+        char* data;
+        size_t size;
+    };
+
+    void reset();
+    void free_chunks();
+
+    vector<Chunk> chunks;
+    size_t current_chunk = 0;
+    size_t offset = 0;
+};
+
+template <typename T>
+using frame_vector = std::pmr::vector<T>;
+
+} // namespace Tmpl8
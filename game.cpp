@@ -1,8 +1,5 @@
 #include "precomp.h" // include (only) this in every .cpp file
 
-constexpr auto num_tanks_blue = 2048;
-constexpr auto num_tanks_red = 2048;
-
 constexpr auto tank_max_health = 1000;
 constexpr auto rocket_hit_value = 60;
 constexpr auto particle_beam_hit_value = 50;
@@ -11,12 +8,13 @@ constexpr auto tank_max_speed = 1.0;
 
 constexpr auto health_bar_width = 70;
 
-constexpr auto max_frames = 2000;
+constexpr auto camera_pan_speed = 8.f; //Screen pixels per frame
+constexpr auto camera_zoom_step = 1.25f;
 
-//Global performance timer
-constexpr auto REF_PERFORMANCE = 23993; //UPDATE THIS WITH YOUR REFERENCE PERFORMANCE (see console after 2k frames)
-static timer perf_timer;
-static float duration;
+//Level of detail (off until L is pressed, it changes the picture): cells with at least
+//lod_density tanks are drawn as a splat, below lod_zoom every tank is (sprites are less than half size by then)
+constexpr auto lod_density = 5;
+constexpr auto lod_zoom = 0.5f;
 
 //Load sprite files and initialize sprites
 static Surface* tank_red_img = new Surface("assets/Tank_Proj2.png");
@@ -41,26 +39,42 @@ const static vec2 rocket_size(6, 6);
 const static float tank_radius = 3.f;
 const static float rocket_radius = 5.f;
 
-const int NUM_OF_THREADS = std::thread::hardware_concurrency() * 2;
-ThreadPool* pool = new ThreadPool(NUM_OF_THREADS);
+int num_threads = std::thread::hardware_concurrency() * 2;
+ThreadPool* pool = new ThreadPool(num_threads);
+//Drives the renderer, so drawing a frame can overlap with updating the next one
+ThreadPool* render_thread = new ThreadPool(1);
 std::mutex mlock;
 vector<future<void>> threads;
 
 //Splits a list of items into even chunks depending on size of dividend and divisor (amount of threads)
 //Gives a list of indices for each chunk in the original list.
-vector<int> split_evenly(int dividend, int divisor) {
+//The list lives in the calling thread's frame arena, so it must not be kept past the frame
+frame_vector<int> split_evenly(int dividend, int divisor) {
     int remainder = dividend % divisor;
 
     int initial_value = floor(dividend / divisor);
-    vector<int> results;
+    frame_vector<int> results(&FrameArena::get());
+    results.reserve(divisor);
     for (int i = 0; i < divisor; i++) {
         results.push_back(initial_value + (remainder-- > 0 ? 1 : 0));
     }
     return results;
 }
 
+//Replace the update pool, 0 restores the default of twice the hardware concurrency
+//Only call while no work is queued
+void set_thread_count(int count) {
+    if (count <= 0) count = std::thread::hardware_concurrency() * 2;
+    if (count == num_threads) return;
+
+    delete pool;
+    num_threads = count;
+    pool = new ThreadPool(num_threads);
+}
+
 //Wait for all threads and clear them
 void wait_and_clear() {
+    TraceScope trace("wait", "wait");
     for (future<void>& t : threads) {
         t.wait();
     }
@@ -68,6 +82,32 @@ void wait_and_clear() {
 }
 
 
+Game::Game(const Scenario& scenario) : scenario(scenario), background_terrain(scenario.map)
+{
+}
+
+// -----------------------------------------------------------
+// Spawn grid for one army
+// GRID keeps the scenario's columns and spacing, FIT keeps the width of that block
+// and shrinks the spacing until the whole army fits above the bottom of the map
+// -----------------------------------------------------------
+static void get_spawn_grid(const Scenario& scenario, int count, float available_height, int& columns, float& spacing)
+{
+    columns = scenario.columns;
+    spacing = scenario.spacing;
+    if (scenario.layout == SpawnLayout::GRID || count <= 0) return;
+
+    const float block_width = scenario.columns * scenario.spacing;
+    spacing = std::min(scenario.spacing, sqrtf((block_width * available_height) / count));
+    while (true)
+    {
+        columns = std::max(1, (int)(block_width / spacing));
+        const int rows = (count + columns - 1) / columns;
+        if (rows * spacing <= available_height) return;
+        spacing *= 0.95f;
+    }
+}
+
 // -----------------------------------------------------------
 // Initialize the simulation state
 // This function does not count for the performance multiplier
@@ -77,9 +117,30 @@ void Game::init()
 {
     frame_count_font = new Font("assets/digital_small.png", "ABCDEFGHIJKLMNOPQRSTUVWXYZ:?!=-0123456789.");
 
-    active_tanks.reserve(num_tanks_blue + num_tanks_red);
+    const vec2 world_size = background_terrain.get_world_size();
+    background = std::make_unique<Surface>((int)world_size.x, (int)world_size.y);
+    background->clear(0);
+    background_terrain.draw(background.get());
+
+    camera = Camera(HEALTHBAR_OFFSET, 0, SCRWIDTH - (HEALTHBAR_OFFSET * 2), SCRHEIGHT, world_size);
+
+    tank_grids = { uniform_grid(world_size), uniform_grid(world_size) };
+    rocket_grid = uniform_grid(world_size);
+
+    Trace::set_thread_name("main");
+    pool->set_metrics(&metrics);
+    render_thread->set_metrics(&metrics);
+    if (PerfCounters::is_enabled()) PerfCounters::attach_threads();
+
+    active_tanks.reserve(scenario.tanks_blue + scenario.tanks_red);
+    wrecks_to_bake.reserve(scenario.tanks_blue + scenario.tanks_red);
+    wrecks.reserve(scenario.tanks_blue + scenario.tanks_red);
+    destroyed_tanks.reserve(scenario.tanks_blue + scenario.tanks_red);
 
-    uint max_rows = 24;
+    for (HealthHistogram& health_histogram : health_histograms)
+    {
+        health_histogram.init(tank_max_health);
+    }
 
     float start_blue_x = tank_size.x + 40.0f;
     float start_blue_y = tank_size.y + 30.0f;
@@ -87,24 +148,44 @@ void Game::init()
     float start_red_x = 1088.0f;
     float start_red_y = tank_size.y + 30.0f;
 
-    float spacing = 7.5f;
+    //Leave a tank's height free at the bottom of the map
+    const float available_height = world_size.y - start_blue_y - tank_size.y;
+
+    int max_rows;
+    float spacing;
 
     //Spawn blue tanks
-    for (int i = 0; i < num_tanks_blue; i++)
+    get_spawn_grid(scenario, scenario.tanks_blue, available_height, max_rows, spacing);
+    for (int i = 0; i < scenario.tanks_blue; i++)
     {
         vec2 position{ start_blue_x + ((i % max_rows) * spacing), start_blue_y + ((i / max_rows) * spacing) };
-        active_tanks.push_back(Tank(position.x, position.y, BLUE, &tank_blue, &smoke, 1100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed));
+        active_tanks.push_back(Tank(position.x, position.y, BLUE, &tank_blue, &smoke, 1100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed, &health_histograms[BLUE]));
     }
     //Spawn red tanks
-    for (int i = 0; i < num_tanks_red; i++)
+    get_spawn_grid(scenario, scenario.tanks_red, available_height, max_rows, spacing);
+    for (int i = 0; i < scenario.tanks_red; i++)
     {
         vec2 position{ start_red_x + ((i % max_rows) * spacing), start_red_y + ((i / max_rows) * spacing) };
-        active_tanks.push_back(Tank(position.x, position.y, RED, &tank_red, &smoke, 100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed));
+        active_tanks.push_back(Tank(position.x, position.y, RED, &tank_red, &smoke, 100.f, position.y + 16, tank_radius, tank_max_health, tank_max_speed, &health_histograms[RED]));
+    }
+
+    if (scenario.beams)
+    {
+        particle_beams.push_back(Particle_beam(vec2(590, 327), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
+        particle_beams.push_back(Particle_beam(vec2(64, 64), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
+        particle_beams.push_back(Particle_beam(vec2(1200, 600), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
     }
 
-    particle_beams.push_back(Particle_beam(vec2(590, 327), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
-    particle_beams.push_back(Particle_beam(vec2(64, 64), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
-    particle_beams.push_back(Particle_beam(vec2(1200, 600), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value));
+    Baseline baseline;
+    if (baseline.load(default_baseline_path))
+    {
+        const vector<double>* durations = baseline.find(scenario.name, "duration");
+        if (durations) reference_duration = (float)median(*durations);
+    }
+
+    //Loading and spawning don't count for the performance measurement
+    if (AllocationTracker::is_enabled()) AllocationTracker::reset();
+    perf_timer.reset();
 }
 
 // -----------------------------------------------------------
@@ -112,56 +193,80 @@ void Game::init()
 // -----------------------------------------------------------
 void Game::shutdown()
 {
+    //The metrics ring goes away with the game
+    pool->set_metrics(nullptr);
+    render_thread->set_metrics(nullptr);
+
+    if (PerfCounters::is_enabled()) print_phase_counters(std::cout, tank_frames);
+    if (AllocationTracker::is_enabled()) print_allocations(std::cout, frame_count);
+
+    delete frame_count_font;
+    frame_count_font = nullptr;
 }
 
 // -----------------------------------------------------------
-// Iterates through all tanks and returns the closest enemy tank for the given tank
+// Returns the closest active enemy tank for the given tank
+// Searches the enemy team's grid outwards from the tank, so only nearby cells are visited
 // -----------------------------------------------------------
 Tank& Game::find_closest_enemy(Tank& current_tank)
 {
     //Don't multithread, this function is already called from within a thread
-    float closest_distance = numeric_limits<float>::infinity();
-    int closest_index = 0;
-    Tank* closest_tank = nullptr;
+    const uniform_grid& enemies = tank_grids[(current_tank.allignment == BLUE) ? RED : BLUE];
+    const int closest_index = enemies.find_nearest(current_tank.position, [&](uint32_t i) { return active_tanks[i].active; });
+
+    //Without enemies left aim at the first tank, there is nothing to hit anyway
+    return active_tanks.at((closest_index >= 0) ? closest_index : 0);
+}
 
-    //Check neighboring tanks first, maybe you'll get lucky
-    //This code is currently (probably) not working, just like the other two parts where neighboring objects are called
-    //This code just defaults to the other (less efficient) method below so it's fine to leave in.
-    vector<movable*> collision_objects = uni_grid.get_neighboring_objects(current_tank.position);
-    for (movable* collision_object : collision_objects)
+// -----------------------------------------------------------
+// Turn the tanks destroyed this frame into wrecks and take them out of active_tanks
+// Swap-and-pop: the last tank fills the hole of every destroyed one, so only the
+// destroyed tanks are touched and the survivors don't shift. That changes their order,
+// the stable_order scenario option shifts them down instead to keep the spawn order.
+// -----------------------------------------------------------
+void Game::remove_destroyed_tanks()
+{
+    if (destroyed_tanks.empty()) return;
+
+    //Highest index first, so the last tank is never one that still has to be removed
+    std::sort(destroyed_tanks.begin(), destroyed_tanks.end(), std::greater<uint32_t>());
+    destroyed_tanks.erase(std::unique(destroyed_tanks.begin(), destroyed_tanks.end()), destroyed_tanks.end());
+
+    for (uint32_t index : destroyed_tanks)
     {
-        if (collision_object->moveable_type == movableType::TANK)
-        {
-            Tank* collidable_tank = (Tank*) collision_object;
-            if (collidable_tank->allignment != current_tank.allignment) {
-                float sqr_dist = fabsf((collidable_tank->get_position() - current_tank.get_position()).sqr_length());
-                if (sqr_dist < closest_distance) {
-                    closest_distance = sqr_dist;
-                    closest_tank = collidable_tank;
-                }
-            }
-        }
+        const Wreck wreck = active_tanks[index].to_wreck();
+        if (wreck.fits(*background)) wrecks_to_bake.push_back(wreck);
+        else wrecks.push_back(wreck);
     }
-    if (closest_tank) {
-        return *closest_tank;
-    }
-
+    wreck_count += (int)destroyed_tanks.size();
 
-    //If there isn't an enemy tank neighboring current tank, check all other tanks
-    for (int i = 0; i < active_tanks.size(); i++)
+    if (scenario.stable_order)
+    {
+        active_tanks.erase(std::remove_if(active_tanks.begin(), active_tanks.end(), [](const Tank& tank) { return !tank.active; }), active_tanks.end());
+    }
+    else
     {
-        if (active_tanks.at(i).allignment != current_tank.allignment && active_tanks.at(i).active)
+        for (uint32_t index : destroyed_tanks)
         {
-            float sqr_dist = fabsf((active_tanks.at(i).get_position() - current_tank.get_position()).sqr_length());
-            if (sqr_dist < closest_distance)
-            {
-                closest_distance = sqr_dist;
-                closest_index = i;
-            }
+            if (index != active_tanks.size() - 1) active_tanks[index] = std::move(active_tanks.back());
+            active_tanks.pop_back();
         }
     }
+    destroyed_tanks.clear();
+}
 
-    return active_tanks.at(closest_index);
+// -----------------------------------------------------------
+// Draw the wrecks of this frame into the background, after that they cost nothing
+// The background is read while the previous frame renders, so this runs at the frame
+// boundary: the draw list recorded this frame is the first one rendered on top of them
+// -----------------------------------------------------------
+void Game::bake_wrecks()
+{
+    for (const Wreck& wreck : wrecks_to_bake)
+    {
+        wreck.draw(*background);
+    }
+    wrecks_to_bake.clear();
 }
 
 //Checks if a point lies on the left of an arbitrary angled line
@@ -183,10 +288,9 @@ bool Tmpl8::Game::left_of_line(vec2 line_start, vec2 line_end, vec2 point)
 // ====
 void Game::update(float deltaTime)
 {
-    threads.reserve(NUM_OF_THREADS);
-    uni_grid.mlock = &mlock;
-    //Split tanks list into chunks equal to NUM_OF_THREADS
-    vector<int> split_sizes_tanks = split_evenly(active_tanks.size(), NUM_OF_THREADS);
+    threads.reserve(num_threads);
+    //Split tanks list into chunks equal to num_threads
+    frame_vector<int> split_sizes_tanks = split_evenly(active_tanks.size(), num_threads);
     //Calculate the route to the destination for each tank using BFS
     //Initializing routes here so it gets counted for performance..
     if (frame_count == 0)
@@ -199,68 +303,38 @@ void Game::update(float deltaTime)
                 for (int j = start_at; j < start_at + count; j++) {
                     Tank& t = active_tanks.at(j);
                     mlock.lock();
-                    t.set_route(background_terrain.get_route(t, t.target));
+                    t.set_route(background_terrain.get_route(t, t.target), background_terrain.get_routes());
                     mlock.unlock();
 
                 }
-                }));
+                }, "routes"));
             //Increase start_at value so next loop starts at the beginning of the next chunk
             start_at += count;
         }
         wait_and_clear();
-
-        // Voeg de moveables toe
-        for (Tank& t : active_tanks)
-        {
-            //t.set_route(background_terrain.get_route(t, t.target));
-            uni_grid.add_to_grid(&t, t.position);            
-        }
-        for (Rocket& r : rockets) {
-            uni_grid.add_to_grid(&r, r.position);
-        }
-        // Voor de particle beam moet ik nog ff kijken morgen.
-
     }
 
-    //This code is currently broken. We think something weird is happening with pointers so tanks don't actually nudge eachother
-    /*int start_at = 0;
-    for (int count : split_sizes_tanks) {
-        threads.push_back(pool->enqueue([&, start_at, count]() {
-            for (int j = start_at; j < start_at + count; j++) {
-                Tank& tank = active_tanks[j];
-                vector<movable*> collision_objects = uni_grid.get_neighboring_objects(tank.position);
-                for (movable* collision_object : collision_objects)
-                {
-                    if (collision_object->moveable_type == movableType::TANK)
-                    {
-                        Tank* collidable_tank = (Tank*) collision_object;
-
-                        if (&tank == collidable_tank || !collidable_tank->active) continue;
-
-                        vec2 dir = tank.get_position() - collidable_tank->get_position();
-                        float dir_squared_len = dir.sqr_length();
+    PhaseTimer phase(metrics, Phase::COLLISION);
 
-                        float col_squared_len = (tank.get_collision_radius() + collidable_tank->get_collision_radius());
-                        col_squared_len *= col_squared_len;
+    //Tanks only move in the tanks phase, so the grids are valid for collision and targeting
+    for (uniform_grid& grid : tank_grids) grid.clear();
+    for (size_t i = 0; i < active_tanks.size(); i++)
+    {
+        tank_grids[active_tanks[i].allignment].add((uint32_t)i, active_tanks[i].position);
+    }
+    for (uniform_grid& grid : tank_grids) grid.finish();
 
-                        if (dir_squared_len < col_squared_len)
-                        {
-                            tank.push(dir.normalized(), 1.f);
-                        }
-                    }
-                }
-            }
-            }));
-    }*/
     int start_at = 0;
     for (int count : split_sizes_tanks) {
         threads.push_back(pool->enqueue([&, start_at, count]() {
             for (int j = start_at; j < start_at + count; j++) {
                 Tank& tank = active_tanks.at(j);
-                    // Check for tank collision.
-                    for (Tank& other_tank : active_tanks)
-                    {
-                        if (&tank == &other_tank || !other_tank.active) continue;
+                //Check for tank collision with the tanks of both teams in the neighbouring cells
+                for (const uniform_grid& grid : tank_grids)
+                {
+                    grid.for_each_near(tank.position, tank.collision_radius + tank_radius, [&](uint32_t i, vec2) {
+                        Tank& other_tank = active_tanks[i];
+                        if (&tank == &other_tank || !other_tank.active) return;
 
                         vec2 dir = tank.get_position() - other_tank.get_position();
                         float dir_squared_len = dir.sqr_length();
@@ -272,97 +346,113 @@ void Game::update(float deltaTime)
                         {
                             tank.push(dir.normalized(), 1.f);
                         }
-                    }
-                    // Check for tank collision with uni_grid.
+                    });
+                }
             }
-            }));
+            }, "collision"));
         start_at += count;
     }
     wait_and_clear();
     
+    phase.next(Phase::ROCKETS);
 
     for (Rocket& rocket : rockets) {
         rocket.tick();
     }
 
+    //Rockets fired in the tanks phase below are only hit tested from the next frame on
+    //Swept rockets are indexed by their new position, so tanks also look as far as the longest step back
+    rocket_grid.clear();
+    rocket_reach = rocket_radius;
+    for (size_t i = 0; i < rockets.size(); i++)
+    {
+        rocket_grid.add((uint32_t)i, rockets[i].position);
+        if (scenario.swept_rockets) rocket_reach = std::max(rocket_reach, rocket_radius + (rockets[i].position - rockets[i].previous_position).length());
+    }
+    rocket_grid.finish();
+
+    //Only grows, atomics can't be moved so the vector is replaced
+    if (rocket_claims.size() < rockets.size()) rocket_claims = vector<std::atomic<uint32_t>>(rockets.size() * 2);
+    for (size_t i = 0; i < rockets.size(); i++) rocket_claims[i].store(no_claim, std::memory_order_relaxed);
+    const size_t rocket_count = rockets.size();
+
+    phase.next(Phase::TANKS);
+
+    //Tanks fire while other tanks loop over the rockets, so the rockets must not be reallocated
+    //Every tank fires at most once per frame, capacity doubles so growing doesn't reallocate every frame
+    if (rockets.capacity() < rockets.size() + active_tanks.size())
+    {
+        rockets.reserve(std::max(rockets.capacity() * 2, rockets.size() + active_tanks.size()));
+    }
+
+    //Move tanks according to speed and nudges (see above) also reload
+    //All tanks move before any of them aims, so no tank sees another one halfway through its tick
+    start_at = 0;
+    for (int count : split_sizes_tanks) {
+        threads.push_back(pool->enqueue([&, start_at, count]() {
+            Tank::tick_range(active_tanks.data() + start_at, count, background_terrain);
+            }, "tanks"));
+        start_at += count;
+    }
+    wait_and_clear();
+
     start_at = 0;
     for (int count : split_sizes_tanks) {
         threads.push_back(pool->enqueue([&, start_at, count]() {
             for (int j = start_at; j < start_at + count; j++) {
                 Tank& tank = active_tanks.at(j);
 
-                //Move tanks according to speed and nudges (see above) also reload
-                if (tank.active) {
-                    tank.tick(background_terrain);
-                }
-                else {
-                    mlock.lock();
-                    inactive_tanks.push_back(tank);
-                    mlock.unlock();
-                }
-
                 //Shoot at closest target if reloaded
                 if (tank.rocket_reloaded())
                 {
                     Tank& target = find_closest_enemy(tank);
 
                     mlock.lock();
-                    rockets.push_back(Rocket(tank.position, (target.get_position() - tank.position).normalized() * 3, rocket_radius, tank.allignment, ((tank.allignment == RED) ? &rocket_red : &rocket_blue)));
+                    rockets.spawn(tank.position, (target.get_position() - tank.position).normalized() * scenario.rocket_speed, rocket_radius, tank.allignment, ((tank.allignment == RED) ? &rocket_red : &rocket_blue));
                     mlock.unlock();
 
                     tank.reload_rocket();
                 }
 
-                //This code is currently broken, we think it does something weird with pointers so rockets fly straight through the tanks
-                /*vector<movable*> collision_objects = uni_grid.get_neighboring_objects(tank.position);
-                for (movable* collision_object : collision_objects)
-                {
-                    if (collision_object->moveable_type == movableType::ROCKET)
-                    {
-                        Rocket& rocket = *(Rocket*) collision_object;
-
-                        if ((tank.allignment != rocket.allignment) && rocket.intersects(tank.position, tank.collision_radius))
-                        {
-                            rocket.active = false;
+                //Claim every rocket in the neighbouring cells that collides with this tank, the lowest tank index wins
+                //A rocket explodes on one tank only, with swept rockets it could otherwise hit every tank along its way
+                rocket_grid.for_each_near(tank.position, tank.collision_radius + rocket_reach, [&](uint32_t i, vec2) {
+                    const Rocket& rocket = rockets[i];
+                    if (!rocket.active || (tank.allignment == rocket.allignment)) return;
+                    if (!(scenario.swept_rockets ? rocket.intersects_swept(tank.position, tank.collision_radius) : rocket.intersects(tank.position, tank.collision_radius))) return;
 
-                            mlock.lock();
-                            explosions.push_back(Explosion(&explosion, tank.position));
-                            mlock.unlock();
+                    uint32_t claim = rocket_claims[i].load(std::memory_order_relaxed);
+                    while ((uint32_t)j < claim && !rocket_claims[i].compare_exchange_weak(claim, (uint32_t)j, std::memory_order_relaxed)) {}
+                });
+            }
+            }, "tanks"));
+        start_at += count;
+    }
+    wait_and_clear();
 
-                            if (tank.hit(rocket_hit_value))
-                            {
-                                mlock.lock();
-                                smokes.push_back(Smoke(smoke, tank.position - vec2(7, 24)));
-                                mlock.unlock();
-                                break;
-                            }
-                        }
-                    }
-                }*/
+    //Claimed rockets explode in rocket order, spawn explosion, and if tank is destroyed spawn a smoke plume
+    //A rocket whose tank was already destroyed by an earlier rocket flies on
+    for (size_t i = 0; i < rocket_count; i++)
+    {
+        const uint32_t j = rocket_claims[i].load(std::memory_order_relaxed);
+        if (j == no_claim || !active_tanks[j].active) continue;
 
-                
-                // Check for rocket collision.
-                //Check if rocket collides with enemy tank, spawn explosion, and if tank is destroyed spawn a smoke plume
-                for (Rocket& rocket : rockets)
-                {
-                    if ((tank.allignment != rocket.allignment) && rocket.intersects(tank.position, tank.collision_radius))
-                    {
-                        // TODO: Should remove rocket from list
-                        rocket.active = false;
+        Tank& tank = active_tanks[j];
+        rockets[i].active = false;
+        explosions.spawn(&explosion, tank.position);
 
-                        mlock.lock();
-                        explosions.push_back(Explosion(&explosion, tank.position));
-                        mlock.unlock();
+        if (tank.hit(rocket_hit_value))
+        {
+            smokes.spawn(&smoke, tank.position - vec2(7, 24));
+            destroyed_tanks.push_back(j);
+        }
+    }
 
-                        if (tank.hit(rocket_hit_value))
-                        {
-                            mlock.lock();
-                            smokes.push_back(Smoke(smoke, tank.position - vec2(7, 24)));
-                            mlock.unlock();
-                            break;
-                        }
-                    }
-                }
+    start_at = 0;
+    for (int count : split_sizes_tanks) {
+        threads.push_back(pool->enqueue([&, start_at, count]() {
+            for (int j = start_at; j < start_at + count; j++) {
+                Tank& tank = active_tanks.at(j);
 
                 // Still need to figure out the location of particle beams to make it work with uni_form grid.
                 // However there are 4 particle beams and wont add a big performance decrease.
@@ -375,7 +465,8 @@ void Game::update(float deltaTime)
                             if (tank.hit(particle_beam.damage))
                             {
                                 mlock.lock();
-                                smokes.push_back(Smoke(smoke, tank.position - vec2(0, 48)));
+                                smokes.spawn(&smoke, tank.position - vec2(0, 48));
+                                destroyed_tanks.push_back(j);
                                 mlock.unlock();
                                 break;
                             }
@@ -384,14 +475,15 @@ void Game::update(float deltaTime)
                 }
 
             }
-            }));
+            }, "tanks"));
         start_at += count;
 
     }
     wait_and_clear();
 
-    //Remove all inactive tanks from the current active_tanks list
-    active_tanks.erase(std::remove_if(active_tanks.begin(), active_tanks.end(), [](const Tank tank) { return !tank.active; }), active_tanks.end());
+    remove_destroyed_tanks();
+
+    phase.next(Phase::HULL);
 
     // Calculate convex hull.
     if (!rockets.empty())
@@ -460,19 +552,21 @@ void Game::update(float deltaTime)
         }*/
     }
 
+    phase.next(Phase::ROCKETS);
+
     // Check if rocket is outside the convex hull.
     //Multithread if there's more than 10 times the number of threads in rockets.
     //Singlethread if there's less than 10 times the number of threads in rockets.
     //This avoids overhead of spawning threads when there's a small amount of rockets
     start_at = 0;
-    if (rockets.size() < 10 * NUM_OF_THREADS) {
+    if (rockets.size() < 10 * num_threads) {
         for (Rocket& rocket : rockets) {
             if (rocket.active) {
                 for (size_t i = 0; i < forcefield_hull.size(); i++)
                 {
                     if (left_of_line(forcefield_hull.at(i), forcefield_hull.at((i + 1) % forcefield_hull.size()), rocket.position))
                     {
-                        explosions.push_back(Explosion(&explosion, rocket.position));
+                        explosions.spawn(&explosion, rocket.position);
                         rocket.active = false;
                         break;
                     }
@@ -481,17 +575,17 @@ void Game::update(float deltaTime)
         }
     }
     else {
-        for (int count : split_sizes_tanks) {
+        for (int count : split_evenly(rockets.size(), num_threads)) {
             threads.push_back(pool->enqueue([&, start_at, count]() {
                 for (int j = start_at; j < start_at + count; j++) {
-                    Rocket& rocket = rockets.at(j);
+                    Rocket& rocket = rockets[j];
                     if (rocket.active) {
                         for (size_t i = 0; i < forcefield_hull.size(); i++)
                         {
                             if (left_of_line(forcefield_hull.at(i), forcefield_hull.at((i + 1) % forcefield_hull.size()), rocket.position))
                             {
                                 mlock.lock();
-                                explosions.push_back(Explosion(&explosion, rocket.position));
+                                explosions.spawn(&explosion, rocket.position);
                                 mlock.unlock();
                                 rocket.active = false;
                                 break;
@@ -499,15 +593,17 @@ void Game::update(float deltaTime)
                         }
                     }
                 }
-                }));
+                }, "rocket hull"));
         }
         wait_and_clear();
     }
-    //Remove exploded rockets with remove erase idiom
-    rockets.erase(std::remove_if(rockets.begin(), rockets.end(), [](const Rocket& rocket) { return !rocket.active; }), rockets.end());
+    //Remove exploded rockets, only the last rocket moves into each hole
+    rockets.despawn_if([](const Rocket& rocket) { return !rocket.active; });
 
 
-    //Update explosion sprites and remove when done with remove erase idiom
+    phase.next(Phase::EFFECTS);
+
+    //Update explosion sprites and remove when done
     // ====
     // Big-O analysis: O (N)
     // ====
@@ -515,7 +611,7 @@ void Game::update(float deltaTime)
     {
         explosion.tick();
     }
-    explosions.erase(std::remove_if(explosions.begin(), explosions.end(), [](const Explosion& explosion) { return explosion.done(); }), explosions.end());
+    explosions.despawn_if([](const Explosion& explosion) { return explosion.done(); });
 
     //Update particle beams
     // ====
@@ -537,102 +633,95 @@ void Game::update(float deltaTime)
 }
 
 // -----------------------------------------------------------
-// Draw all sprites to the screen
-// (It is not recommended to multi-thread this function)
+// Draw the last recorded frame to the screen
+// The tile renderer rasterises the screen tiles in parallel on the thread pool
 // -----------------------------------------------------------
 void Game::draw()
 {
-    //Check how many tanks there are of each color
-    int blue_count = 0;
-    int red_count = 0;
-    for (Tank tank : active_tanks) {
-        if (tank.allignment == BLUE) {
-            blue_count++;
-        }
-        else {
-            red_count++;
-        }
-    }
+    PhaseTimer phase(metrics, Phase::RENDER);
 
-    vector<int> blue_tanks_health; blue_tanks_health.reserve(blue_count);
-    vector<int> red_tanks_health; red_tanks_health.reserve(red_count);
+    //Every tile starts as a copy of the background, so no clear is needed
+    renderer.render(draw_lists[render_list], screen, background.get(), *pool, screen_write_only);
+}
 
-    //Put the health of all tanks into their respective vector
-    for (Tank& tank : active_tanks) {
-        if (tank.allignment == BLUE) {
-            blue_tanks_health.push_back(int(tank.health));
-        }
-        else {
-            red_tanks_health.push_back(int(tank.health));
+// -----------------------------------------------------------
+// Record draw commands for all sprites, lines and health bars
+// Runs after update, the resulting list does not reference the game state
+// -----------------------------------------------------------
+void Game::record_draw_commands(DrawList& draw_list)
+{
+    draw_list.clear();
+    draw_list.set_camera(camera);
+
+    //Count the tanks per screen cell, tanks in crowded cells are mostly hidden behind each other
+    //so they are replaced by a single splat for the whole cell
+    int lod_threshold = numeric_limits<int>::max();
+    frame_vector<int> tank_cells(&FrameArena::get());
+    if (lod_enabled)
+    {
+        lod_threshold = (camera.get_zoom() < lod_zoom) ? 1 : lod_density;
+
+        tank_density.reset(camera);
+        tank_cells.resize(active_tanks.size());
+        for (size_t i = 0; i < active_tanks.size(); i++) {
+            tank_cells[i] = tank_density.cell_of(active_tanks[i].position);
+            tank_density.add(tank_cells[i], active_tanks[i].allignment);
         }
     }
 
-    //Start a thread for each color of tank where they're sorted
-    auto sort_blue = pool->enqueue([&]() {
-        merge_sort(blue_tanks_health);
-        });
-    auto sort_red = pool->enqueue([&]() {
-        merge_sort(red_tanks_health);
-        });
-
-    // clear the graphics window
-    screen->clear(0);
-
-    //Draw background
-    background_terrain.draw(screen);
+    for (size_t i = 0; i < active_tanks.size(); i++) {
+        if (lod_enabled && tank_density.is_dense(tank_cells[i], lod_threshold)) continue;
+        active_tanks[i].draw(draw_list);
+    }
 
-    
-    for (Tank& tank : active_tanks) {
-        tank.draw(screen);
+    if (lod_enabled)
+    {
+        tank_density.draw_splats(draw_list, lod_threshold);
     }
 
-    for (Tank& tank : inactive_tanks) {
-        tank.draw(screen);
+    for (const Wreck& wreck : wrecks) {
+        wreck.draw(draw_list);
     }
 
     for (Rocket& rocket : rockets)
     {
-        rocket.draw(screen);
+        rocket.draw(draw_list);
     }
 
     for (Smoke& smoke : smokes)
     {
-        smoke.draw(screen);
+        smoke.draw(draw_list);
     }
 
     for (Particle_beam& particle_beam : particle_beams)
     {
-        particle_beam.draw(screen);
+        particle_beam.draw(draw_list);
     }
 
     for (Explosion& explosion : explosions)
     {
-        explosion.draw(screen);
+        explosion.draw(draw_list);
     }
 
     //Draw forcefield (mostly for debugging, its kinda ugly..)
     for (size_t i = 0; i < forcefield_hull.size(); i++)
     {
-        vec2 line_start = forcefield_hull.at(i);
-        vec2 line_end = forcefield_hull.at((i + 1) % forcefield_hull.size());
-        line_start.x += HEALTHBAR_OFFSET;
-        line_end.x += HEALTHBAR_OFFSET;
-        screen->line(line_start, line_end, 0x0000ff);
+        const vec2 line_start = forcefield_hull.at(i);
+        const vec2 line_end = forcefield_hull.at((i + 1) % forcefield_hull.size());
+        if (!camera.is_visible(vec2(std::min(line_start.x, line_end.x), std::min(line_start.y, line_end.y)), vec2(std::max(line_start.x, line_end.x), std::max(line_start.y, line_end.y)))) continue;
+
+        draw_list.draw_line(camera.world_to_screen(line_start), camera.world_to_screen(line_end), 0x0000ff);
     }
     
-    //Wait for the sorting threads to finish
-    sort_blue.wait();
-    sort_red.wait();
-
-
-    //Draw the health bars for both tank health lists, the integer represents the color
+    //Draw the health bars for both teams, the histograms are kept up to date by the tanks themselves
+    //The integer represents the color
     //0 for blue
     //1 for red
-    draw_health_bars(blue_tanks_health, 0);
-    draw_health_bars(red_tanks_health, 1);
+    draw_health_bars(health_histograms[BLUE], 0, draw_list);
+    draw_health_bars(health_histograms[RED], 1, draw_list);
 }
 
-void Tmpl8::Game::merge(vector<int>& left, vector<int>& right, vector<int>& tanks_health) {
+void Tmpl8::Game::merge(const frame_vector<int>& left, const frame_vector<int>& right, int* tanks_health) {
     int left_size = left.size();
     int right_size = right.size();
     int i = 0; int j = 0; int k = 0;
@@ -650,25 +739,30 @@ void Tmpl8::Game::merge(vector<int>& left, vector<int>& right, vector<int>& tank
 }
 
 void Tmpl8::Game::merge_sort(vector<int>& tanks_health) {
-    if (tanks_health.size() <= 1) return;
+    merge_sort(tanks_health.data(), (int)tanks_health.size());
+}
 
-    int middle = tanks_health.size() / 2;
+void Tmpl8::Game::merge_sort(int* tanks_health, int size) {
+    if (size <= 1) return;
 
-    vector<int> left; left.reserve(middle);
-    vector<int> right; right.reserve(tanks_health.size() - middle);
-    std::copy(tanks_health.begin(), tanks_health.begin() + middle, std::back_inserter(left));
-    std::copy(tanks_health.begin() + middle, tanks_health.end(), std::back_inserter(right));
+    int middle = size / 2;
 
-    merge_sort(left);
-    merge_sort(right);
+    //The halves are copied into the frame arena, handed back on return so the recursion reuses the memory
+    FrameArena::Scope scope;
+    frame_vector<int> left(tanks_health, tanks_health + middle, &FrameArena::get());
+    frame_vector<int> right(tanks_health + middle, tanks_health + size, &FrameArena::get());
+
+    merge_sort(left.data(), middle);
+    merge_sort(right.data(), size - middle);
     Game::merge(left, right, tanks_health);
 }
 
 
 // -----------------------------------------------------------
 // Draw the health bars based on the given tanks health values
+// The histogram hands out the lowest health values in ascending order, so no sort is needed
 // -----------------------------------------------------------
-void Tmpl8::Game::draw_health_bars(const vector<int>& sorted_health, const int team)
+void Tmpl8::Game::draw_health_bars(const HealthHistogram& health_histogram, const int team, DrawList& draw_list)
 {
     int health_bar_start_x = (team < 1) ? 0 : (SCRWIDTH - HEALTHBAR_OFFSET) - 1;
     int health_bar_end_x = (team < 1) ? health_bar_width : health_bar_start_x + health_bar_width - 1;
@@ -679,39 +773,40 @@ void Tmpl8::Game::draw_health_bars(const vector<int>& sorted_health, const int t
         int health_bar_start_y = i * 1;
         int health_bar_end_y = health_bar_start_y + 1;
 
-        screen->bar(health_bar_start_x, health_bar_start_y, health_bar_end_x, health_bar_end_y, REDMASK);
+        draw_list.draw_bar(health_bar_start_x, health_bar_start_y, health_bar_end_x, health_bar_end_y, REDMASK);
     }
 
     //Draw the <SCRHEIGHT> least healthy tank health bars
-    int draw_count = std::min(SCRHEIGHT, (int)sorted_health.size());
+    int draw_count = std::min(SCRHEIGHT, health_histogram.size());
 
-    for (int i = 0; i < draw_count - 1; i++)
-    {
+    health_histogram.for_each_lowest(draw_count - 1, [&](int i, int health) {
         //Health bars are 1 pixel each
         int health_bar_start_y = i * 1;
         int health_bar_end_y = health_bar_start_y + 1;
 
-        float health_fraction = (1 - ((double)sorted_health[i] / (double)tank_max_health));
+        float health_fraction = (1 - ((double)health / (double)tank_max_health));
 
-        if (team == 0) { screen->bar(health_bar_start_x + (int)((double)health_bar_width * health_fraction), health_bar_start_y, health_bar_end_x, health_bar_end_y, GREENMASK); }
-        else { screen->bar(health_bar_start_x, health_bar_start_y, health_bar_end_x - (int)((double)health_bar_width * health_fraction), health_bar_end_y, GREENMASK); }
-    }
+        if (team == 0) { draw_list.draw_bar(health_bar_start_x + (int)((double)health_bar_width * health_fraction), health_bar_start_y, health_bar_end_x, health_bar_end_y, GREENMASK); }
+        else { draw_list.draw_bar(health_bar_start_x, health_bar_start_y, health_bar_end_x - (int)((double)health_bar_width * health_fraction), health_bar_end_y, GREENMASK); }
+        });
 }
 
 // -----------------------------------------------------------
-// When we reach max_frames print the duration and speedup multiplier
-// Updating REF_PERFORMANCE at the top of this file with the value
-// on your machine gives you an idea of the speedup your optimizations give
+// When we reach the scenario's frame count print the duration and speedup multiplier
+// The speedup is relative to the median duration of this scenario in the stored
+// benchmark baseline (see benchmark.h), it is left out when there is none
 // -----------------------------------------------------------
-void Tmpl8::Game::measure_performance()
+void Tmpl8::Game::measure_performance(DrawList& draw_list)
 {
     char buffer[128];
-    if (frame_count >= max_frames)
+    if (frame_count >= scenario.frames)
     {
         if (!lock_update)
         {
             duration = perf_timer.elapsed();
-            cout << "Duration was: " << duration << " (Replace REF_PERFORMANCE with this value)" << endl;
+            cout << "Duration was: " << duration;
+            if (reference_duration > 0.f) cout << " (baseline " << reference_duration << ", speedup " << (reference_duration / duration) << ")";
+            cout << endl;
             lock_update = true;
         }
 
@@ -720,12 +815,15 @@ void Tmpl8::Game::measure_performance()
 
     if (lock_update)
     {
-        screen->bar(420 + HEALTHBAR_OFFSET, 170, 870 + HEALTHBAR_OFFSET, 430, 0x030000);
+        draw_list.draw_bar(420 + HEALTHBAR_OFFSET, 170, 870 + HEALTHBAR_OFFSET, 430, 0x030000);
         int ms = (int)duration % 1000, sec = ((int)duration / 1000) % 60, min = ((int)duration / 60000);
         sprintf(buffer, "%02i:%02i:%03i", min, sec, ms);
-        frame_count_font->centre(screen, buffer, 200);
-        sprintf(buffer, "SPEEDUP: %4.1f", REF_PERFORMANCE / duration);
-        frame_count_font->centre(screen, buffer, 340);
+        draw_list.draw_text(frame_count_font, buffer, (SCRWIDTH - frame_count_font->width(buffer)) / 2, 200);
+        if (reference_duration > 0.f)
+        {
+            sprintf(buffer, "SPEEDUP: %4.1f", reference_duration / duration);
+            draw_list.draw_text(frame_count_font, buffer, (SCRWIDTH - frame_count_font->width(buffer)) / 2, 340);
+        }
     }
 }
 
@@ -734,13 +832,68 @@ void Tmpl8::Game::measure_performance()
 // -----------------------------------------------------------
 void Game::tick(float deltaTime)
 {
-    if (!lock_update)
+    //Draw the commands recorded last tick while the next frame is being simulated,
+    //so a frame costs about max(update, draw) instead of update + draw
+    future<void> render_task = render_thread->enqueue([&]() {
+        draw();
+        }, "render");
+
+    //Counters are summed over all threads, so phases may not overlap while they are sampled
+    if (PerfCounters::is_enabled()) render_task.wait();
+
+    const bool updating = !lock_update;
+    if (updating)
     {
+        PhaseTimer phase(metrics, Phase::UPDATE);
         update(deltaTime);
     }
-    draw();
 
-    measure_performance();
+    //Also record when the simulation is done, so the camera can still be moved around
+    {
+        PhaseTimer phase(metrics, Phase::RECORD);
+        move_camera();
+        record_draw_commands(draw_lists[1 - render_list]);
+    }
+
+    {
+        PhaseTimer phase(metrics, Phase::WAIT);
+        render_task.wait();
+        bake_wrecks();
+
+        //Frame boundary: every task has finished, so the temporaries of this frame can go
+        pool->wait_idle();
+        render_thread->wait_idle();
+        FrameArena::reset_all();
+    }
+    render_list = 1 - render_list;
+
+    //The overlays go on top of the frame just recorded, so they are drawn into its tiles as well
+    //and nothing is drawn to the screen after the renderer wrote it
+    DrawList& overlay = draw_lists[render_list];
+    measure_performance(overlay);
+
+    frame_metrics.collect(metrics);
+    if (updating)
+    {
+        for (int i = 0; i < (int)Phase::COUNT; i++) phase_totals[i] += frame_metrics.phase_times[i];
+        tank_frames += active_tanks.size();
+    }
+    hud.add_frame(frame_metrics, frame_timer.elapsed());
+    frame_timer.reset();
+    if (AllocationTracker::is_enabled())
+    {
+        std::array<AllocationTracker::Totals, (int)Phase::COUNT> phase_allocations;
+        for (int i = 0; i < (int)Phase::COUNT; i++)
+        {
+            const AllocationTracker::Totals total = AllocationTracker::get_section_total(i);
+            phase_allocations[i] = total - phase_allocations_seen[i];
+            phase_allocations_seen[i] = total;
+        }
+        const AllocationTracker::Totals total = AllocationTracker::get_total();
+        hud.add_allocations(phase_allocations, total - allocations_seen);
+        allocations_seen = total;
+    }
+    hud.draw(overlay, frame_count_font, { (int)active_tanks.size(), wreck_count, (int)rockets.size(), (int)smokes.size(), (int)explosions.size() });
 
     // print something in the graphics window
     //screen->Print("hello world", 2, 2, 0xffffff);
@@ -750,8 +903,87 @@ void Game::tick(float deltaTime)
 
     //Print frame count
     frame_count++;
-    string frame_count_string = "FRAME: " + std::to_string(frame_count);
-    frame_count_font->print(screen, frame_count_string.c_str(), 350, 580);
+    char frame_count_string[32];
+    snprintf(frame_count_string, sizeof(frame_count_string), "FRAME: %lld", frame_count);
+    overlay.draw_text(frame_count_font, frame_count_string, 350, 580);
+}
+
+// -----------------------------------------------------------
+// Camera controls
+// Panning keys are held down, so they are applied once per frame in move_camera
+// -----------------------------------------------------------
+void Game::key_down(int key)
+{
+    const vec2 viewport_center((float)(SCRWIDTH / 2), (float)(SCRHEIGHT / 2));
+
+    switch (key)
+    {
+    case SDL_SCANCODE_LEFT:
+    case SDL_SCANCODE_A:
+        pan_left = true;
+        break;
+    case SDL_SCANCODE_RIGHT:
+    case SDL_SCANCODE_D:
+        pan_right = true;
+        break;
+    case SDL_SCANCODE_UP:
+    case SDL_SCANCODE_W:
+        pan_up = true;
+        break;
+    case SDL_SCANCODE_DOWN:
+    case SDL_SCANCODE_S:
+        pan_down = true;
+        break;
+    case SDL_SCANCODE_EQUALS:
+    case SDL_SCANCODE_KP_PLUS:
+        camera.zoom_at(camera_zoom_step, viewport_center);
+        break;
+    case SDL_SCANCODE_MINUS:
+    case SDL_SCANCODE_KP_MINUS:
+        camera.zoom_at(1.f / camera_zoom_step, viewport_center);
+        break;
+    case SDL_SCANCODE_HOME:
+        camera.reset();
+        break;
+    case SDL_SCANCODE_L:
+        lod_enabled = !lod_enabled;
+        break;
+    case SDL_SCANCODE_H:
+        hud.toggle();
+        break;
+    }
+}
+
+void Game::key_up(int key)
+{
+    switch (key)
+    {
+    case SDL_SCANCODE_LEFT:
+    case SDL_SCANCODE_A:
+        pan_left = false;
+        break;
+    case SDL_SCANCODE_RIGHT:
+    case SDL_SCANCODE_D:
+        pan_right = false;
+        break;
+    case SDL_SCANCODE_UP:
+    case SDL_SCANCODE_W:
+        pan_up = false;
+        break;
+    case SDL_SCANCODE_DOWN:
+    case SDL_SCANCODE_S:
+        pan_down = false;
+        break;
+    }
+}
+
+void Game::move_camera()
+{
+    const vec2 direction((float)(pan_right - pan_left), (float)(pan_down - pan_up));
+    if (direction != vec2(0.f))
+    {
+        camera.pan(direction * camera_pan_speed);
+    }
 }
 
 // -----------------------------------------------------------
@@ -778,8 +1010,9 @@ void Game::grahamScan(vector<Tank>& tankList, vector<vec2>& convex_hull) {
     // Make copy of sorted list, removing duplicate polar angle incices
     // Check if list is bigger than 3
     // Run through Graham Scan algorithm, continuously checking if resulting hull is convex, otherwise removing a value
-    vector<vec2> sorted_list;
-    for (auto tank : tankList) {
+    frame_vector<vec2> sorted_list(&FrameArena::get());
+    sorted_list.reserve(tankList.size());
+    for (const Tank& tank : tankList) {
         sorted_list.push_back(tank.position);
     }
 
@@ -816,7 +1049,9 @@ void Game::grahamScan(vector<Tank>& tankList, vector<vec2>& convex_hull) {
         });
 
     //Sort out the duplicate polar angles in the list and only keep the one farthest away
-    vector<vec2> non_duplicate_sorted_list{ sorted_list.front() };
+    frame_vector<vec2> non_duplicate_sorted_list(&FrameArena::get());
+    non_duplicate_sorted_list.reserve(sorted_list.size());
+    non_duplicate_sorted_list.push_back(sorted_list.front());
     for (size_t i = 1; i < sorted_list.size() - 1; i++) {
         if (orientation(p0, sorted_list[i], sorted_list[i + 1]) == 0) continue;
         else non_duplicate_sorted_list.push_back(sorted_list[i]);
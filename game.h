@@ -1,5 +1,4 @@
 #pragma once
-#include "uniform_grid.h"
 
 namespace Tmpl8
 {
@@ -12,21 +11,41 @@ namespace Tmpl8
     class Game
     {
     public:
-        void set_target(Surface* surface) { screen = surface; }
+        explicit Game(const Scenario& scenario = Scenario());
+
+        //Write-only targets (such as mapped pixel buffers) are never read, see TileRenderer
+        void set_target(Surface* surface, bool write_only = false)
+        {
+            screen = surface;
+            screen_write_only = write_only;
+        }
         void init();
         void shutdown();
         void update(float deltaTime);
         void draw();
+        void record_draw_commands(DrawList& draw_list);
         void tick(float deltaTime);
         int orientation(vec2& a, vec2& b, vec2& c);
         void grahamScan(vector<Tank>& tankList, vector<vec2>& convex_hull);
         void insertion_sort_tanks_health(const std::vector<int*> sorting_array, int const begin_index, int const end_index);
-        void merge(vector<int>& left, vector<int>& right, vector<int>& tanks_health);
+        void merge(const frame_vector<int>& left, const frame_vector<int>& right, int* tanks_health);
         void merge_sort(vector<int>& tanks_health);
-        void draw_health_bars(const std::vector<int>& sorted_health, const int team);
-        void measure_performance();
+        void merge_sort(int* tanks_health, int size);
+        void draw_health_bars(const HealthHistogram& health_histogram, const int team, DrawList& draw_list);
+        void measure_performance(DrawList& draw_list);
+
+        //The scenario's frame count has been simulated
+        bool is_finished() const { return lock_update; }
+        //Milliseconds from the end of init until the last frame was simulated
+        float get_duration() const { return duration; }
+        //Milliseconds spent in every phase over all simulated frames
+        const std::array<double, (int)Phase::COUNT>& get_phase_totals() const { return phase_totals; }
+        int get_tank_count() const { return (int)active_tanks.size(); }
+        const vector<Tank>& get_active_tanks() const { return active_tanks; }
 
         Tank& find_closest_enemy(Tank& current_tank);
+        void remove_destroyed_tanks();
+        void bake_wrecks();
 
         void mouse_up(int button)
         { /* implement if you want to detect mouse button presses */
@@ -40,27 +59,66 @@ namespace Tmpl8
         { /* implement if you want to detect mouse movement */
         }
 
-        void key_up(int key)
-        { /* implement if you want to handle keys */
-        }
-
-        void key_down(int key)
-        { /* implement if you want to handle keys */
-        }
+        //Arrow keys or WASD pan the camera, +/- zoom and Home resets the view
+        //L toggles level of detail, H toggles the performance HUD
+        void key_up(int key);
+        void key_down(int key);
+        void move_camera();
 
     private:
         Surface* screen;
+        bool screen_write_only = false;
+
+        Scenario scenario;
 
         vector<Tank> active_tanks;
-        vector<Tank> inactive_tanks;
-        vector<Rocket> rockets;
-        vector<Smoke> smokes;
-        vector<Explosion> explosions;
+        //Wrecks that fit on the background are drawn into it once, only the others are drawn every frame
+        vector<Wreck> wrecks_to_bake;
+        vector<Wreck> wrecks;
+        int wreck_count = 0;
+        vector<uint32_t> destroyed_tanks; //Indices into active_tanks of the tanks destroyed this frame
+        EntityPool<Rocket> rockets;
+        EntityPool<Smoke> smokes;
+        EntityPool<Explosion> explosions;
         vector<Particle_beam> particle_beams;
 
+        //Health values per team, indexed by allignment
+        std::array<HealthHistogram, 2> health_histograms;
+
         Terrain background_terrain;
         std::vector<vec2> forcefield_hull;
 
+        //Terrain is static, so it is drawn once (in world space) and copied into every tile
+        std::unique_ptr<Surface> background;
+
+        //View on the world between the health bars, pan directions are held down keys
+        Camera camera;
+        bool pan_left = false, pan_right = false, pan_up = false, pan_down = false;
+
+        //Level of detail, crowded tanks are drawn as density splats
+        DensityBuffer tank_density;
+        bool lod_enabled = false;
+        TileRenderer renderer;
+
+        //Double buffered draw commands, update records into one list while the other one is rendered
+        std::array<DrawList, 2> draw_lists;
+        int render_list = 0;
+
+        //Timings pushed by the pool workers and the phase timers, shown by the HUD
+        MetricsRing metrics;
+        FrameMetrics frame_metrics;
+        std::array<double, (int)Phase::COUNT> phase_totals = {};
+        double tank_frames = 0.0; //Active tanks summed over all simulated frames, for counts per tank
+        //Allocation totals at the end of the previous frame, the HUD shows the difference
+        std::array<AllocationTracker::Totals, (int)Phase::COUNT> phase_allocations_seen;
+        AllocationTracker::Totals allocations_seen;
+        Hud hud;
+        timer frame_timer;
+
+        timer perf_timer;
+        float duration = 0.f;
+        float reference_duration = 0.f; //Median duration in the benchmark baseline, 0 without one
+
         Font* frame_count_font;
         long long frame_count = 0;
 
@@ -69,11 +127,20 @@ namespace Tmpl8
         //Checks if a point lies on the left of an arbitrary angled line
         bool left_of_line(vec2 line_start, vec2 line_end, vec2 point);
 
-        uniform_grid uni_grid;
+        //Rebuilt every frame, tanks per team (indexed by allignment) and rockets
+        std::array<uniform_grid, 2> tank_grids;
+        uniform_grid rocket_grid;
+        float rocket_reach = 0.f; //Distance from its grid position within which a rocket can hit this frame
+        //Per rocket in the grid, the lowest index of the active tanks it hits, no_claim when it hits none
+        static constexpr uint32_t no_claim = ~0u;
+        vector<std::atomic<uint32_t>> rocket_claims;
     };
 
 }; // namespace Tmpl8
 
-vector<int> split_evenly(int size, int split_size);
+frame_vector<int> split_evenly(int size, int split_size);
 
 void wait_and_clear(vector<future<void>>& threads);
+
+extern int num_threads;
+void set_thread_count(int count);
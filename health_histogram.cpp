@@ -0,0 +1,39 @@
+#include "precomp.h"
+#include "health_histogram.h"
+
+namespace Tmpl8
+{
+
+void HealthHistogram::init(int max_health)
+{
+    bucket_count = max_health + 1;
+    counts = std::make_unique<std::atomic<int>[]>(bucket_count);
+    for (int i = 0; i < bucket_count; i++)
+    {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+}
+
+void HealthHistogram::add(int health)
+{
+    counts[bucket(health)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HealthHistogram::remove(int health)
+{
+    counts[bucket(health)].fetch_sub(1, std::memory_order_relaxed);
+    total.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void HealthHistogram::move(int old_health, int new_health)
+{
+    const int old_bucket = bucket(old_health), new_bucket = bucket(new_health);
+    if (old_bucket == new_bucket) return;
+
+    counts[old_bucket].fetch_sub(1, std::memory_order_relaxed);
+    counts[new_bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace Tmpl8
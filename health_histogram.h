@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Counts how many tanks have each health value, so the lowest
+// health values can be read in order without sorting or scanning all tanks.
+// Tanks keep it up to date themselves when they are hit or deactivated,
+// so the cost of maintaining it is proportional to the number of hits.
+// Counts are atomic because tanks are hit from several threads at once.
+// -----------------------------------------------------------
+class HealthHistogram
+{
+  public:
+    //Allocate a bucket for every health value in [0, max_health]
+    void init(int max_health);
+
+    //Health values outside [0, max_health] are clamped into the nearest bucket
+    void add(int health);
+    void remove(int health);
+    void move(int old_health, int new_health);
+
+    int size() const { return total.load(std::memory_order_relaxed); }
+
+    //Calls func(index, health) for the k lowest health values, in ascending order
+    //Only call this while no tanks are being hit
+    template <typename Func>
+    void for_each_lowest(int k, Func func) const
+    {
+        int index = 0;
+        for (int health = 0; health < bucket_count && index < k; health++)
+        {
+            const int count = counts[health].load(std::memory_order_relaxed);
+            for (int i = 0; i < count && index < k; i++)
+            {
+                func(index++, health);
+            }
+        }
+    }
+
+  private:
+    int bucket(int health) const { return clamp(health, 0, bucket_count - 1); }
+
+    std::unique_ptr<std::atomic<int>[]> counts;
+    int bucket_count = 0;
+    std::atomic<int> total = 0;
+};
+
+} // namespace Tmpl8
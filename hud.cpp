@@ -0,0 +1,152 @@
+#include "precomp.h"
+#include "hud.h"
+
+namespace Tmpl8
+{
+
+constexpr float hud_smoothing = 0.05f;
+
+constexpr int hud_x = HEALTHBAR_OFFSET + 8;
+constexpr int hud_y = 8;
+constexpr int hud_padding = 6;
+constexpr int hud_width = Hud::history_size + (hud_padding * 2);
+constexpr int hud_column_width = 140;
+
+constexpr int graph_height = 64;
+constexpr float graph_ms_per_pixel = 0.5f;
+constexpr float graph_target_ms = 1000.f / 60.f;
+constexpr int worker_bar_height = 24;
+
+void Hud::add_frame(const FrameMetrics& frame, float frame_time)
+{
+    worker_utilisation.resize(frame.worker_busy.size(), 0.f);
+
+    frame_times[history_position] = frame_time;
+    history_position = (history_position + 1) % history_size;
+
+    for (int i = 0; i < (int)Phase::COUNT; i++)
+    {
+        phase_times[i] += (frame.phase_times[i] - phase_times[i]) * hud_smoothing;
+    }
+
+    for (size_t i = 0; i < frame.worker_busy.size(); i++)
+    {
+        const float utilisation = (frame_time > 0.f) ? std::min(frame.worker_busy[i] / frame_time, 1.f) : 0.f;
+        worker_utilisation[i] += (utilisation - worker_utilisation[i]) * hud_smoothing;
+    }
+}
+
+void Hud::add_allocations(const std::array<AllocationTracker::Totals, (int)Phase::COUNT>& phases, const AllocationTracker::Totals& total)
+{
+    show_allocations = true;
+    for (int i = 0; i < (int)Phase::COUNT; i++)
+    {
+        phase_allocations[i] += ((float)phases[i].allocations - phase_allocations[i]) * hud_smoothing;
+    }
+    allocations += ((float)total.allocations - allocations) * hud_smoothing;
+    allocated_kb += ((float)total.bytes / 1024.f - allocated_kb) * hud_smoothing;
+    frees += ((float)total.frees - frees) * hud_smoothing;
+}
+
+// -----------------------------------------------------------
+// Record the overlay on top of the frame in the draw list
+// All text is laid out first and drawn in one go
+// -----------------------------------------------------------
+void Hud::draw(DrawList& draw_list, Font* font, const Counts& counts)
+{
+    if (!visible) return;
+
+    const int line_height = font->height() + 2;
+    const int phase_lines = (int)Phase::COUNT;
+    const int height = hud_padding + line_height + graph_height + hud_padding + (phase_lines * line_height) + hud_padding + line_height + worker_bar_height + hud_padding;
+
+    //Darken the panel so the text stays readable on top of the battle
+    draw_list.draw_shade(hud_x, hud_y, hud_x + hud_width - 1, hud_y + height - 1, 12);
+
+    char buffer[64];
+    glyphs.clear();
+    int x = hud_x + hud_padding;
+    int y = hud_y + hud_padding;
+
+    //Frame time graph, newest frame on the right
+    float average = 0.f, maximum = 0.f;
+    for (float frame_time : frame_times)
+    {
+        average += frame_time;
+        maximum = std::max(maximum, frame_time);
+    }
+    average /= history_size;
+
+    sprintf(buffer, "FRAME %.1f AVG %.1f MAX %.1f", frame_times[(history_position + history_size - 1) % history_size], average, maximum);
+    font->layout(buffer, x, y, glyphs);
+    y += line_height;
+
+    const int graph_bottom = y + graph_height - 1;
+    for (int i = 0; i < history_size; i++)
+    {
+        const float frame_time = frame_times[(history_position + i) % history_size];
+        const int bar_height = std::min(graph_height, (int)(frame_time / graph_ms_per_pixel));
+        if (bar_height <= 0) continue;
+
+        const Pixel color = (frame_time <= graph_target_ms) ? 0x00c000 : ((frame_time <= graph_target_ms * 2) ? 0xc0c000 : 0xc00000);
+        draw_list.draw_bar(x + i, graph_bottom - bar_height + 1, x + i, graph_bottom, color);
+    }
+    const int target_line = graph_bottom - (int)(graph_target_ms / graph_ms_per_pixel);
+    draw_list.draw_line(vec2((float)x, (float)target_line), vec2((float)(x + history_size - 1), (float)target_line), 0x606060);
+    y += graph_height + hud_padding;
+
+    //Phases on the left (with their allocations when tracked), entity counts on the right
+    for (int i = 0; i < phase_lines; i++)
+    {
+        if (show_allocations) sprintf(buffer, "%s %.2f %.0f", phase_names[i], phase_times[i], phase_allocations[i]);
+        else sprintf(buffer, "%s %.2f", phase_names[i], phase_times[i]);
+        font->layout(buffer, x, y + i * line_height, glyphs);
+    }
+
+    const std::pair<const char*, int> count_lines[] = {
+        { "TANKS", counts.active_tanks },
+        { "INACTIVE", counts.inactive_tanks },
+        { "ROCKETS", counts.rockets },
+        { "SMOKES", counts.smokes },
+        { "EXPLOSIONS", counts.explosions }};
+    for (int i = 0; i < (int)std::size(count_lines); i++)
+    {
+        sprintf(buffer, "%s %i", count_lines[i].first, count_lines[i].second);
+        font->layout(buffer, x + hud_column_width, y + i * line_height, glyphs);
+    }
+
+    //Heap activity per frame, below the counts
+    if (show_allocations)
+    {
+        const int allocation_y = y + (int)std::size(count_lines) * line_height;
+        sprintf(buffer, "ALLOCS %.0f", allocations);
+        font->layout(buffer, x + hud_column_width, allocation_y, glyphs);
+        sprintf(buffer, "ALLOC KB %.1f", allocated_kb);
+        font->layout(buffer, x + hud_column_width, allocation_y + line_height, glyphs);
+        sprintf(buffer, "FREES %.0f", frees);
+        font->layout(buffer, x + hud_column_width, allocation_y + line_height * 2, glyphs);
+    }
+    y += phase_lines * line_height + hud_padding;
+
+    //One bar per worker, full height means the worker was busy the whole frame
+    float total_utilisation = 0.f;
+    for (float utilisation : worker_utilisation) total_utilisation += utilisation;
+    const int workers = std::max(1, (int)worker_utilisation.size());
+
+    sprintf(buffer, "THREADS %i BUSY %.0f", workers, (total_utilisation * 100.f) / workers);
+    font->layout(buffer, x, y, glyphs);
+    y += line_height;
+
+    const int bar_width = std::max(1, history_size / workers - 1);
+    for (int i = 0; i < (int)worker_utilisation.size() && (i * (bar_width + 1)) < history_size; i++)
+    {
+        const int bar_x = x + i * (bar_width + 1);
+        const int bar_height = (int)(worker_utilisation[i] * worker_bar_height);
+        draw_list.draw_bar(bar_x, y, bar_x + bar_width - 1, y + worker_bar_height - 1, 0x202020);
+        if (bar_height > 0) draw_list.draw_bar(bar_x, y + worker_bar_height - bar_height, bar_x + bar_width - 1, y + worker_bar_height - 1, 0x4080ff);
+    }
+
+    draw_list.draw_glyphs(font, glyphs);
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Toggleable performance overlay.
+// Shows a rolling frame time graph, the time spent in every phase of the frame,
+// entity counts and how busy every pool worker was, plus the heap allocations
+// per frame when allocation tracking is on. Timings come from the metrics
+// ring, which the workers and the phase timers push to without locking.
+// -----------------------------------------------------------
+class Hud
+{
+  public:
+    static constexpr int history_size = 256; //Frames shown in the graph
+
+    struct Counts
+    {
+        int active_tanks;
+        int inactive_tanks;
+        int rockets;
+        int smokes;
+        int explosions;
+    };
+
+    void toggle() { visible = !visible; }
+    bool is_visible() const { return visible; }
+
+    //Add a frame to the history, call once per frame (also while hidden)
+    void add_frame(const FrameMetrics& frame, float frame_time);
+    //Heap activity of the frame, only while the AllocationTracker is enabled
+    void add_allocations(const std::array<AllocationTracker::Totals, (int)Phase::COUNT>& phases, const AllocationTracker::Totals& total);
+
+    //Records the overlay in screen space, on top of what is already in the list
+    void draw(DrawList& draw_list, Font* font, const Counts& counts);
+
+  private:
+    bool visible = false;
+
+    std::array<float, history_size> frame_times = {};
+    int history_position = 0;
+
+    //Exponential moving averages, so the numbers stay readable
+    std::array<float, (int)Phase::COUNT> phase_times = {};
+    vector<float> worker_utilisation;
+
+    bool show_allocations = false;
+    std::array<float, (int)Phase::COUNT> phase_allocations = {};
+    float allocations = 0.f, allocated_kb = 0.f, frees = 0.f;
+
+    vector<Font::Glyph> glyphs;
+};
+
+} // namespace Tmpl8
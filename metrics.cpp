@@ -0,0 +1,105 @@
+#include "precomp.h"
+#include "metrics.h"
+
+namespace Tmpl8
+{
+
+const char* const phase_names[(int)Phase::COUNT] = {
+    "UPDATE",
+    "COLLISION",
+    "TANKS",
+    "HULL",
+    "ROCKETS",
+    "EFFECTS",
+    "RECORD",
+    "RENDER",
+    "WAIT"};
+
+void FrameMetrics::collect(MetricsRing& ring)
+{
+    phase_times.fill(0.f);
+    worker_busy.assign(ThreadPool::get_total_workers(), 0.f);
+
+    MetricSample sample;
+    while (ring.pop(sample))
+    {
+        if (sample.type == MetricType::TASK)
+        {
+            if (sample.id < worker_busy.size()) worker_busy[sample.id] += sample.duration;
+        }
+        else if (sample.id < (int)Phase::COUNT)
+        {
+            phase_times[sample.id] += sample.duration;
+        }
+    }
+}
+
+// -----------------------------------------------------------
+// One line per phase: counts in millions, instructions per cycle
+// and the misses per tank per frame
+// -----------------------------------------------------------
+void print_phase_counters(std::ostream& stream, double entity_frames)
+{
+    constexpr size_t field_size = 32;
+    const auto format = [](char* buffer, bool available, double value, const char* pattern) {
+        if (available) snprintf(buffer, field_size, pattern, value);
+        else snprintf(buffer, field_size, "%10s", "n/a");
+    };
+
+    const bool has_cycles = PerfCounters::is_available(PerfCounters::CYCLES);
+    const bool has_instructions = PerfCounters::is_available(PerfCounters::INSTRUCTIONS);
+    const bool has_llc = PerfCounters::is_available(PerfCounters::LLC_MISSES);
+    const bool has_branches = PerfCounters::is_available(PerfCounters::BRANCH_MISSES);
+    const double per_entity = (entity_frames > 0.0) ? 1.0 / entity_frames : 0.0;
+
+    char line[192];
+    snprintf(line, sizeof(line), "%-10s %10s %10s %10s %10s %10s", "PHASE", "CYCLES M", "INSTR M", "IPC", "LLC/TANK", "BRANCH/TANK");
+    stream << line << std::endl;
+
+    for (int p = 0; p < (int)Phase::COUNT; p++)
+    {
+        const PerfCounters::Values total = PerfCounters::get_total(p);
+        char cycles[field_size], instructions[field_size], ipc[field_size], llc[field_size], branches[field_size];
+        format(cycles, has_cycles, total[PerfCounters::CYCLES] / 1e6, "%10.1f");
+        format(instructions, has_instructions, total[PerfCounters::INSTRUCTIONS] / 1e6, "%10.1f");
+        format(ipc, has_cycles && has_instructions && total[PerfCounters::CYCLES] > 0.0, total[PerfCounters::INSTRUCTIONS] / std::max(total[PerfCounters::CYCLES], 1.0), "%10.2f");
+        format(llc, has_llc, total[PerfCounters::LLC_MISSES] * per_entity, "%10.3f");
+        format(branches, has_branches, total[PerfCounters::BRANCH_MISSES] * per_entity, "%10.3f");
+
+        snprintf(line, sizeof(line), "%-10s %s %s %s %s %s", phase_names[p], cycles, instructions, ipc, llc, branches);
+        stream << line << std::endl;
+    }
+}
+
+// -----------------------------------------------------------
+// One line per phase, averaged over the frames, and the totals of every thread
+// Allocations outside of all phases (loading, spawning, the HUD) are listed as OTHER
+// -----------------------------------------------------------
+void print_allocations(std::ostream& stream, int frames)
+{
+    const double per_frame = 1.0 / std::max(frames, 1);
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-10s %12s %12s %12s %12s", "PHASE", "ALLOCS", "ALLOCS/FRAME", "KB/FRAME", "FREES/FRAME");
+    stream << line << std::endl;
+
+    for (int p = -1; p < (int)Phase::COUNT; p++)
+    {
+        const AllocationTracker::Totals total = AllocationTracker::get_section_total(p);
+        snprintf(line, sizeof(line), "%-10s %12" PRIu64 " %12.1f %12.2f %12.1f", (p < 0) ? "OTHER" : phase_names[p], total.allocations,
+                total.allocations * per_frame, (total.bytes / 1024.0) * per_frame, total.frees * per_frame);
+        stream << line << std::endl;
+    }
+
+    snprintf(line, sizeof(line), "%-10s %12s %12s", "THREAD", "ALLOCS", "KB");
+    stream << line << std::endl;
+    for (int thread = 0; thread < AllocationTracker::get_thread_count(); thread++)
+    {
+        const AllocationTracker::Totals total = AllocationTracker::get_thread_total(thread);
+        char name[32];
+        snprintf(line, sizeof(line), "%-10s %12" PRIu64 " %12.1f", AllocationTracker::get_thread_name(thread, name), total.allocations, total.bytes / 1024.0);
+        stream << line << std::endl;
+    }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,190 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+//Parts of a frame that are timed separately, see phase_names for how the HUD shows them
+enum class Phase : uint8_t
+{
+    UPDATE,
+    COLLISION,
+    TANKS,
+    HULL,
+    ROCKETS,
+    EFFECTS,
+    RECORD,
+    RENDER,
+    WAIT,
+    COUNT
+};
+
+extern const char* const phase_names[(int)Phase::COUNT];
+
+static_assert((int)Phase::COUNT <= PerfCounters::max_sections, "Every phase needs its own performance counter section");
+static_assert((int)Phase::COUNT <= AllocationTracker::max_sections, "Every phase needs its own allocation section");
+
+//Hardware counters per phase since PerfCounters::attach_threads, entity_frames is the tank count summed over all frames
+void print_phase_counters(std::ostream& stream, double entity_frames);
+
+//Heap allocations per phase and per thread since AllocationTracker::reset
+void print_allocations(std::ostream& stream, int frames);
+
+enum class MetricType : uint8_t
+{
+    TASK,  //A thread pool task finished, id is the worker index
+    PHASE  //A phase of the frame finished, id is the Phase
+};
+
+struct MetricSample
+{
+    MetricType type;
+    uint16_t id;
+    float duration; //Milliseconds
+};
+
+// -----------------------------------------------------------
+// Bounded lock-free ring buffer with many producers and a single consumer.
+// Every slot has a sequence number that tells whose turn it is (a producer
+// writing it or the consumer reading it), so producers only contend on the
+// write position and never wait for each other.
+// When the ring is full new samples are dropped instead of blocking the producer.
+// -----------------------------------------------------------
+template <typename T, size_t N>
+class RingBuffer
+{
+    static_assert((N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+  public:
+    RingBuffer()
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //Safe to call from any thread, returns false when the ring is full
+    bool push(const T& value)
+    {
+        size_t position = write_position.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = slots[position & (N - 1)];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+            if (difference == 0)
+            {
+                if (write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = write_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //Only call from the consumer thread, returns false when the ring is empty
+    bool pop(T& value)
+    {
+        Slot& slot = slots[read_position & (N - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != read_position + 1) return false;
+
+        value = slot.value;
+        slot.sequence.store(read_position + N, std::memory_order_release);
+        read_position++;
+        return true;
+    }
+
+    size_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+  private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::array<Slot, N> slots;
+
+    //Producers and the consumer write different positions, keep them on separate cache lines
+    alignas(64) std::atomic<size_t> write_position = 0;
+    alignas(64) size_t read_position = 0;
+    std::atomic<size_t> dropped = 0;
+};
+
+using MetricsRing = RingBuffer<MetricSample, 4096>;
+
+// -----------------------------------------------------------
+// Everything pushed to the ring during one frame, summed per phase and per worker
+// -----------------------------------------------------------
+struct FrameMetrics
+{
+    std::array<float, (int)Phase::COUNT> phase_times = {};
+    vector<float> worker_busy; //Milliseconds spent running tasks, indexed by worker
+
+    //Drain the ring, only call from the ring's consumer thread
+    void collect(MetricsRing& ring);
+};
+
+// -----------------------------------------------------------
+// Times a phase of the frame and pushes it to the ring when it goes out of scope
+// next() ends the current phase and starts timing the given one, so
+// consecutive phases of a function can share one timer
+// -----------------------------------------------------------
+class PhaseTimer
+{
+  public:
+    PhaseTimer(MetricsRing& ring, Phase phase) : ring(ring), phase(phase), outer_section(AllocationTracker::get_section())
+    {
+        AllocationTracker::set_section((int)phase);
+        if (PerfCounters::is_enabled()) counters_begin = PerfCounters::read();
+    }
+    ~PhaseTimer()
+    {
+        finish();
+        AllocationTracker::set_section(outer_section);
+    }
+
+    void next(Phase next_phase)
+    {
+        finish();
+        phase = next_phase;
+        AllocationTracker::set_section((int)phase);
+        phase_timer.reset();
+        if (PerfCounters::is_enabled()) counters_begin = PerfCounters::read();
+    }
+
+  private:
+    //Also shows up as a marker in the trace when tracing is enabled
+    void finish()
+    {
+        ring.push({ MetricType::PHASE, (uint16_t)phase, phase_timer.elapsed() });
+        if (Trace::is_enabled()) Trace::record(phase_names[(int)phase], "phase", phase_timer.start, timer::get());
+
+        if (PerfCounters::is_enabled())
+        {
+            PerfCounters::Values delta = PerfCounters::read();
+            for (int c = 0; c < PerfCounters::COUNT; c++) delta[c] -= counters_begin[c];
+            PerfCounters::add((int)phase, delta);
+        }
+    }
+
+    MetricsRing& ring;
+    Phase phase;
+    int outer_section; //Allocations go back to it when the phase ends
+    timer phase_timer;
+    PerfCounters::Values counters_begin = {};
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,235 @@
+#include "precomp.h"
+#include "microbench.h"
+
+namespace Tmpl8
+{
+
+//Results are folded into this, so the compiler can't drop a kernel whose result is unused
+static volatile int64_t sink = 0;
+
+bool Microbench::parse_arguments(int argc, char** argv)
+{
+    bool requested = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        const bool has_value = (i + 1 < argc) && (argv[i + 1][0] != '-');
+
+        if (argument == "--microbench")
+        {
+            requested = true;
+            if (has_value) filter = argv[++i];
+        }
+        else if (argument == "--out" && has_value)
+        {
+            results_path = argv[++i];
+        }
+    }
+    return requested;
+}
+
+Microbench::Result Microbench::measure(const Kernel& kernel) const
+{
+    //Kernels put their temporaries in the frame arena, hand them back after every batch
+    //like the game does after every frame, outside of the timing
+    const auto end_batch = []() { FrameArena::reset_all(); };
+
+    //Warm up caches and allocations, then find how many calls fill a batch
+    kernel.body();
+    end_batch();
+
+    int calls = 1;
+    while (true)
+    {
+        timer batch_timer;
+        for (int i = 0; i < calls; i++) kernel.body();
+        const float elapsed = batch_timer.elapsed();
+        end_batch();
+
+        if (elapsed >= min_batch_time) break;
+        calls = (elapsed > 0.f) ? std::max(calls + 1, (int)(calls * (min_batch_time * 1.2f) / elapsed)) : calls * 10;
+    }
+
+    vector<double> samples;
+    for (int batch = 0; batch < batches; batch++)
+    {
+        const timer::TimePoint begin = timer::get();
+        for (int i = 0; i < calls; i++) kernel.body();
+        const timer::TimePoint end = timer::get();
+        end_batch();
+
+        samples.push_back(std::chrono::duration<double, std::micro>(end - begin).count() / calls);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    return { kernel.name, kernel.items, calls, samples[samples.size() / 2], samples.front() };
+}
+
+int Microbench::run()
+{
+    //Spawn the default scenario, only init runs so the data is the real starting layout
+    Surface screen(SCRWIDTH, SCRHEIGHT);
+    Game game;
+    game.set_target(&screen);
+    game.init();
+
+    const vector<Tank> tanks = game.get_active_tanks();
+
+    Terrain terrain;
+
+    //Built like the game builds them every frame
+    const auto build_grids = [&](std::array<uniform_grid, 2>& grids) {
+        for (uniform_grid& grid : grids) grid.clear();
+        for (size_t i = 0; i < tanks.size(); i++) grids[tanks[i].allignment].add((uint32_t)i, tanks[i].position);
+        for (uniform_grid& grid : grids) grid.finish();
+    };
+    std::array<uniform_grid, 2> tank_grids;
+    build_grids(tank_grids);
+
+    //Routes are expensive, so only a spread out sample of tanks is routed per call
+    constexpr int route_samples = 64;
+    vector<const Tank*> route_tanks;
+    for (int i = 0; i < route_samples; i++) route_tanks.push_back(&tanks[(i * tanks.size()) / route_samples]);
+    vector<vec2> route;
+
+    //Health values as they are halfway through a battle
+    vector<int> health_values;
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> health_distribution(0, 1000);
+    for (size_t i = 0; i < tanks.size(); i++) health_values.push_back(health_distribution(random));
+
+    //One rocket per tank, fired at the tank straight across on the other side
+    vector<Rocket> rockets;
+    const size_t half = tanks.size() / 2;
+    for (size_t i = 0; i < tanks.size(); i++)
+    {
+        const Tank& tank = tanks[i];
+        const Tank& target = tanks[(i + half) % tanks.size()];
+        rockets.push_back(Rocket(tank.position, (target.position - tank.position).normalized() * 3, 5.f, tank.allignment, nullptr));
+        rockets.back().previous_position = tank.position - rockets.back().speed; //As if it moved one step to get here
+    }
+    constexpr int rocket_samples = 256;
+
+    //Ticking moves the tanks, so the tick kernels work on their own copy that keeps driving on
+    vector<Tank> moving_tanks = tanks;
+
+    const int tank_count = (int)tanks.size();
+    const vector<Kernel> kernels = {
+        { "uniform_grid::build", tank_count, [&]() {
+             build_grids(tank_grids);
+         } },
+        { "uniform_grid::for_each_near", tank_count, [&]() {
+             int64_t found = 0;
+             for (const Tank& tank : tanks)
+             {
+                 for (const uniform_grid& grid : tank_grids) grid.for_each_near(tank.position, tank.collision_radius * 2, [&](uint32_t, vec2) { found++; });
+             }
+             sink = sink + found;
+         } },
+        { "uniform_grid::find_nearest", tank_count, [&]() {
+             int64_t total = 0;
+             for (const Tank& tank : tanks) total += tank_grids[(tank.allignment == BLUE) ? RED : BLUE].find_nearest(tank.position, [](uint32_t) { return true; });
+             sink = sink + total;
+         } },
+        { "Terrain::find_route", route_samples, [&]() {
+             int64_t length = 0;
+             for (const Tank* tank : route_tanks)
+             {
+                 terrain.find_route(tank->position, tank->target, route);
+                 length += route.size();
+             }
+             sink = sink + length;
+         } },
+        { "Tank::tick", tank_count, [&]() {
+             for (Tank& tank : moving_tanks) tank.tick(terrain);
+             sink = sink + moving_tanks.front().current_frame;
+         } },
+        { "Tank::tick_range", tank_count, [&]() {
+             Tank::tick_range(moving_tanks.data(), moving_tanks.size(), terrain);
+             sink = sink + moving_tanks.front().current_frame;
+         } },
+        { "Game::grahamScan", tank_count, [&]() {
+             vector<Tank> tank_list = tanks;
+             vector<vec2> hull;
+             game.grahamScan(tank_list, hull);
+             sink = sink + hull.size();
+         } },
+        { "Game::merge_sort", tank_count, [&]() {
+             vector<int> values = health_values;
+             game.merge_sort(values);
+             sink = sink + values.front();
+         } },
+        { "Sprite::draw", tank_count, [&]() {
+             for (const Tank& tank : tanks) tank.tank_sprite->draw(&screen, (int)tank.position.x - 7 + HEALTHBAR_OFFSET, (int)tank.position.y - 9);
+         } },
+        { "Surface::clear", SCRWIDTH * SCRHEIGHT, [&]() {
+             screen.clear(0);
+         } },
+        { "Rocket::intersects", rocket_samples * tank_count, [&]() {
+             int64_t hits = 0;
+             for (int r = 0; r < rocket_samples; r++)
+             {
+                 const Rocket& rocket = rockets[(r * rockets.size()) / rocket_samples];
+                 for (const Tank& tank : tanks) hits += rocket.intersects(tank.position, tank.collision_radius);
+             }
+             sink = sink + hits;
+         } },
+        { "Rocket::intersects_swept", rocket_samples * tank_count, [&]() {
+             int64_t hits = 0;
+             for (int r = 0; r < rocket_samples; r++)
+             {
+                 const Rocket& rocket = rockets[(r * rockets.size()) / rocket_samples];
+                 for (const Tank& tank : tanks) hits += rocket.intersects_swept(tank.position, tank.collision_radius);
+             }
+             sink = sink + hits;
+         } },
+    };
+
+    std::cout << "Microbenchmarks on " << tank_count << " tanks (" << batches << " batches of at least " << min_batch_time << " ms per kernel)" << std::endl;
+
+    vector<Result> results;
+    for (const Kernel& kernel : kernels)
+    {
+        if (!filter.empty() && std::string(kernel.name).find(filter) == std::string::npos) continue;
+
+        const Result result = measure(kernel);
+        results.push_back(result);
+
+        char line[160];
+        sprintf(line, "%-40s %12.2f us  (min %10.2f us, %8.2f ns per item)", result.name, result.median, result.min, (result.median * 1000.0) / result.items);
+        std::cout << line << std::endl;
+    }
+
+    game.shutdown();
+
+    if (results.empty())
+    {
+        std::cout << "No kernel matches \"" << filter << "\"" << std::endl;
+        return 2;
+    }
+    return write_results(results) ? 0 : 2;
+}
+
+bool Microbench::write_results(const vector<Result>& results) const
+{
+    if (results_path.empty()) return true;
+
+    std::ofstream file(results_path);
+    if (!file)
+    {
+        std::cout << "Could not write microbenchmark results to " << results_path << std::endl;
+        return false;
+    }
+
+    file << "{\n  \"kernels\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        file << "    { \"name\": \"" << result.name << "\", \"items\": " << result.items << ", \"calls_per_batch\": " << result.calls_per_batch
+             << ", \"median_us\": " << result.median << ", \"min_us\": " << result.min << " }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return true;
+}
+
+} // namespace Tmpl8
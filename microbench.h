@@ -0,0 +1,53 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Microbenchmarks for the hot kernels, run without opening a window.
+// The data comes from the default scenario right after spawning
+// (spawn layout, assets/terrain.txt and the game's sprites).
+//
+//   --microbench [filter]   run the kernels whose name contains filter (all when omitted)
+//   --out file              also write the results as JSON
+//
+// Every kernel is timed in batches of at least min_batch_time, the reported
+// numbers are the median and minimum over all batches.
+// -----------------------------------------------------------
+class Microbench
+{
+  public:
+    //Returns false when --microbench isn't on the command line
+    bool parse_arguments(int argc, char** argv);
+
+    //Runs the kernels, returns the exit code for the process
+    int run();
+
+  private:
+    static constexpr float min_batch_time = 20.f; //Milliseconds
+    static constexpr int batches = 15;
+
+    struct Kernel
+    {
+        const char* name;
+        int items; //Work items per call, used for the time per item
+        std::function<void()> body;
+    };
+
+    struct Result
+    {
+        const char* name;
+        int items;
+        int calls_per_batch;
+        double median; //Microseconds per call
+        double min;
+    };
+
+    Result measure(const Kernel& kernel) const;
+    bool write_results(const vector<Result>& results) const;
+
+    std::string filter;
+    std::string results_path;
+};
+
+} // namespace Tmpl8
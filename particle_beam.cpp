@@ -26,15 +26,14 @@ void Particle_beam::tick(vector<Tank>& tanks)
     }
 }
 
-void Particle_beam::draw(Surface* screen)
+void Particle_beam::draw(DrawList& draw_list)
 {
     vec2 position = rectangle.min;
 
     const int offset_x = 23;
     const int offset_y = 137;
 
-    particle_beam_sprite->set_frame(sprite_frame / 10);
-    particle_beam_sprite->draw(screen, (int)(position.x - offset_x + HEALTHBAR_OFFSET), (int)(position.y - offset_y));
+    draw_list.draw_world_sprite(particle_beam_sprite, sprite_frame / 10, position, -offset_x, -offset_y);
 }
 
 } // namespace Tmpl8
\ No newline at end of file
@@ -9,7 +9,7 @@ class Particle_beam : public movable
     Particle_beam(vec2 min, vec2 max, Sprite* particle_beam_sprite, int damage);
 
     void tick(vector<Tank>& tanks);
-    void draw(Surface* screen);
+    void draw(DrawList& draw_list);
 
     vec2 min_position;
     vec2 max_position;
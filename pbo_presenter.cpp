@@ -0,0 +1,160 @@
+#include "precomp.h"
+#include "pbo_presenter.h"
+
+namespace Tmpl8
+{
+
+bool PBOPresenter::init(SDL_Window* window, int width, int height)
+{
+    this->window = window;
+    this->width = width;
+    this->height = height;
+
+    context = SDL_GL_CreateContext(window);
+    if (!context)
+    {
+        std::cout << "PBO presenter: could not create an OpenGL context: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK || !GLEW_ARB_buffer_storage || !GLEW_ARB_sync)
+    {
+        std::cout << "PBO presenter: ARB_buffer_storage and ARB_sync are required, " << glGetString(GL_RENDERER) << " does not support them" << std::endl;
+        shutdown();
+        return false;
+    }
+    //glewInit can leave an error behind on some drivers
+    glGetError();
+
+    //Don't wait for vsync, presentation should not limit the frame rate
+    SDL_GL_SetSwapInterval(0);
+
+    glViewport(0, 0, width, height);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glEnable(GL_TEXTURE_2D);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+
+    //Persistent and coherent: the buffers stay mapped and writes become visible without flushing
+    //Write-only, the buffers are never read on the CPU
+    const GLsizeiptr size = (GLsizeiptr)width * height * sizeof(Pixel);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(buffer_count, pbos);
+    for (int i = 0; i < buffer_count; i++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        mapped[i] = (Pixel*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        if (!mapped[i])
+        {
+            std::cout << "PBO presenter: could not map pixel buffer " << i << std::endl;
+            shutdown();
+            return false;
+        }
+        memset(mapped[i], 0, size);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "PBO presenter: OpenGL error during setup" << std::endl;
+        shutdown();
+        return false;
+    }
+
+    std::cout << "Presenting through persistently mapped PBOs on " << glGetString(GL_RENDERER) << std::endl;
+    current = 0;
+    return true;
+}
+
+void PBOPresenter::shutdown()
+{
+    if (!context) return;
+
+    for (int i = 0; i < buffer_count; i++)
+    {
+        if (fences[i]) glDeleteSync(fences[i]);
+        fences[i] = 0;
+        if (mapped[i])
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            mapped[i] = nullptr;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (pbos[0]) glDeleteBuffers(buffer_count, pbos);
+    if (texture) glDeleteTextures(1, &texture);
+    texture = 0;
+    std::fill(std::begin(pbos), std::end(pbos), 0);
+
+    SDL_GL_DeleteContext(context);
+    context = nullptr;
+}
+
+Pixel* PBOPresenter::next_buffer()
+{
+    wait_for(current);
+    return mapped[current];
+}
+
+void PBOPresenter::present()
+{
+    //The upload is sourced from the bound PBO, so the driver copies it when the GPU gets to it
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[current]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    //Signalled once the GPU has consumed this buffer
+    if (fences[current]) glDeleteSync(fences[current]);
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(0.0f, 1.0f);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2f(1.0f, 0.0f);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(0.0f, 0.0f);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    SDL_GL_SwapWindow(window);
+
+    current = (current + 1) % buffer_count;
+}
+
+void PBOPresenter::wait_for(int buffer)
+{
+    GLsync fence = fences[buffer];
+    if (fence)
+    {
+        //Flush on the first wait so the fence is guaranteed to signal
+        GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true)
+        {
+            const GLenum result = glClientWaitSync(fence, wait_flags, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            wait_flags = 0;
+        }
+        glDeleteSync(fence);
+        fences[buffer] = 0;
+    }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,51 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Presents frames through persistently mapped pixel buffer objects.
+// The game renders straight into one of three mapped buffers, which is then uploaded
+// to a texture by the driver, without mapping, locking or copying anything per frame.
+// The buffers are mapped write-only (the memory is often write-combined, and reading
+// it is slow or not allowed), which works because the tile renderer blends in tiles
+// of its own and only writes the finished tiles to its target. A fence per buffer
+// makes sure a buffer is never overwritten while the GPU is still reading from it.
+// Requires ARB_buffer_storage and ARB_sync (OpenGL 4.4); init() returns
+// false when these are not available so the caller can fall back.
+// -----------------------------------------------------------
+class PBOPresenter
+{
+  public:
+    static constexpr int buffer_count = 3;
+
+    //The window must have been created with SDL_WINDOW_OPENGL
+    bool init(SDL_Window* window, int width, int height);
+    void shutdown();
+
+    //Buffer to render the next frame into, width by height pixels without padding
+    //Waits until the GPU is done with it, the buffer may only be written to
+    Pixel* next_buffer();
+    //Upload the buffer handed out by the last next_buffer() and show it
+    void present();
+
+  private:
+    //Waits until the GPU is done with the buffer
+    void wait_for(int buffer);
+
+    SDL_Window* window = nullptr;
+    SDL_GLContext context = nullptr;
+
+    int width = 0;
+    int height = 0;
+
+    GLuint texture = 0;
+    GLuint pbos[buffer_count] = {};
+    Pixel* mapped[buffer_count] = {};
+    GLsync fences[buffer_count] = {};
+
+    //Buffer the game renders into
+    int current = 0;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,141 @@
+#include "precomp.h"
+#include "perf_counters.h"
+
+namespace Tmpl8
+{
+
+#ifdef __linux__
+
+static int open_counter(int thread_id, PerfCounters::Counter counter)
+{
+    perf_event_attr attributes = {};
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    switch (counter)
+    {
+    case PerfCounters::CYCLES: attributes.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PerfCounters::INSTRUCTIONS: attributes.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PerfCounters::LLC_MISSES: attributes.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case PerfCounters::BRANCH_MISSES: attributes.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    default: return -1;
+    }
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    //User space only, works with perf_event_paranoid up to 2
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attributes, thread_id, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static vector<int> get_thread_ids()
+{
+    vector<int> thread_ids;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task", error))
+    {
+        thread_ids.push_back(std::stoi(entry.path().filename().string()));
+    }
+    return thread_ids;
+}
+
+static double read_counter(int descriptor)
+{
+    uint64_t values[3]; //Value, time enabled, time running
+    if (::read(descriptor, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0) return 0.0;
+    return (double)values[0] * ((double)values[1] / (double)values[2]);
+}
+
+bool PerfCounters::enable()
+{
+    attach_threads();
+    for (bool counter_available : available)
+    {
+        if (counter_available)
+        {
+            enabled = true;
+            return true;
+        }
+    }
+
+    const int error = errno;
+    close_all();
+    std::cout << "Performance counters are unavailable (" << strerror(error) << "), check /proc/sys/kernel/perf_event_paranoid or the container's seccomp profile" << std::endl;
+    return false;
+}
+
+void PerfCounters::attach_threads()
+{
+    close_all();
+    available.fill(false);
+
+    for (int thread_id : get_thread_ids())
+    {
+        std::array<int, COUNT> descriptors;
+        for (int c = 0; c < COUNT; c++)
+        {
+            descriptors[c] = open_counter(thread_id, (Counter)c);
+            if (descriptors[c] >= 0) available[c] = true;
+        }
+        thread_counters.push_back(descriptors);
+    }
+
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    totals = {};
+}
+
+void PerfCounters::close_all()
+{
+    for (const std::array<int, COUNT>& descriptors : thread_counters)
+    {
+        for (int descriptor : descriptors)
+        {
+            if (descriptor >= 0) close(descriptor);
+        }
+    }
+    thread_counters.clear();
+}
+
+PerfCounters::Values PerfCounters::read()
+{
+    Values values = {};
+    for (const std::array<int, COUNT>& descriptors : thread_counters)
+    {
+        for (int c = 0; c < COUNT; c++)
+        {
+            if (descriptors[c] >= 0) values[c] += read_counter(descriptors[c]);
+        }
+    }
+    return values;
+}
+
+#else
+
+bool PerfCounters::enable()
+{
+    std::cout << "Performance counters are only supported on Linux" << std::endl;
+    return false;
+}
+
+void PerfCounters::attach_threads() {}
+void PerfCounters::close_all() {}
+
+PerfCounters::Values PerfCounters::read()
+{
+    return {};
+}
+
+#endif
+
+void PerfCounters::add(int section, const Values& delta)
+{
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    for (int c = 0; c < COUNT; c++) totals[section][c] += delta[c];
+}
+
+PerfCounters::Values PerfCounters::get_total(int section)
+{
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    return totals[section];
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Optional hardware performance counters (Linux perf_event_open).
+// Every thread of the process gets its own counters and read() sums them, so
+// the counts between two reads include the work handed to the thread pools.
+// Counts are accumulated per section (the phases of a frame, see PhaseTimer).
+// Counters the machine or container doesn't allow are reported as unavailable,
+// when none can be opened the layer stays disabled and costs nothing.
+// -----------------------------------------------------------
+class PerfCounters
+{
+  public:
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        COUNT
+    };
+
+    using Values = std::array<double, COUNT>;
+
+    static constexpr int max_sections = 16;
+
+    //Returns false (and stays disabled) when no counter can be opened
+    static bool enable();
+    static bool is_enabled() { return enabled; }
+    static bool is_available(Counter counter) { return available[counter]; }
+
+    //Open counters for the threads that exist now and reset the totals,
+    //call after the thread pools changed and while no work is running
+    static void attach_threads();
+
+    //Sum of every counter over all attached threads, scaled up when the kernel had to multiplex
+    static Values read();
+
+    static void add(int section, const Values& delta);
+    static Values get_total(int section);
+
+  private:
+    static void close_all();
+
+    static inline bool enabled = false;
+    static inline std::array<bool, COUNT> available = {};
+
+    static inline vector<std::array<int, COUNT>> thread_counters; //File descriptors, -1 when not open
+
+    static inline std::mutex totals_mutex;
+    static inline std::array<Values, max_sections> totals = {};
+};
+
+} // namespace Tmpl8
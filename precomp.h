@@ -30,6 +30,13 @@
 
 #endif
 
+#ifdef __linux__
+// Hardware performance counters (perf_counters.cpp)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 // External dependencies:
 #include <FreeImage.h>
 
@@ -41,14 +48,18 @@
 // C++ headers
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <limits>
+#include <map>
 #include <memory>
+#include <memory_resource>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <deque>
@@ -78,10 +89,25 @@ using namespace std;
 
 #include "template.h"
 #include "surface.h"
+#include "surface_ops.h"
 
 using namespace Tmpl8;
 
+#include "trace.h"
+#include "allocation_tracker.h"
+#include "frame_arena.h"
+#include "baseline.h"
+#include "perf_counters.h"
+#include "metrics.h"
 #include "thread_pool.h"
+#include "camera.h"
+#include "draw_list.h"
+#include "tile_renderer.h"
+#include "density_buffer.h"
+#include "health_histogram.h"
+#include "entity_pool.h"
+#include "uniform_grid.h"
+#include "route_pool.h"
 
 #include "tank.h"
 #include "terrain.h"
@@ -90,6 +116,12 @@ using namespace Tmpl8;
 #include "explosion.h"
 #include "particle_beam.h"
 
+#include "scenario.h"
+#include "hud.h"
 #include "game.h"
+#include "benchmark.h"
+#include "microbench.h"
+#include "selftest.h"
+#include "pbo_presenter.h"
 
 // clang-format on
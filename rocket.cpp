@@ -5,7 +5,7 @@
 namespace Tmpl8
 {
 Rocket::Rocket(vec2 position, vec2 direction, float collision_radius, allignments allignment, Sprite* rocket_sprite)
-    : position(position), speed(direction), collision_radius(collision_radius), allignment(allignment), current_frame(0), rocket_sprite(rocket_sprite), active(true)
+    : position(position), previous_position(position), speed(direction), collision_radius(collision_radius), allignment(allignment), current_frame(0), rocket_sprite(rocket_sprite), active(true)
 {
     this->moveable_type = movableType::ROCKET;
 }
@@ -16,15 +16,16 @@ Rocket::~Rocket()
 
 void Rocket::tick()
 {
+    previous_position = position;
     position += speed;
     if (++current_frame > 8) current_frame = 0;
 }
 
 //Draw the sprite with the facing based on this rockets movement direction
-void Rocket::draw(Surface* screen)
+void Rocket::draw(DrawList& draw_list)
 {
-    rocket_sprite->set_frame(((abs(speed.x) > abs(speed.y)) ? ((speed.x < 0) ? 3 : 0) : ((speed.y < 0) ? 9 : 6)) + (current_frame / 3));
-    rocket_sprite->draw(screen, (int)position.x - 12 + HEALTHBAR_OFFSET, (int)position.y - 12);
+    const int frame = ((abs(speed.x) > abs(speed.y)) ? ((speed.x < 0) ? 3 : 0) : ((speed.y < 0) ? 9 : 6)) + (current_frame / 3);
+    draw_list.draw_world_sprite(rocket_sprite, frame, position, -12, -12);
 }
 
 //Does the given circle collide with this rockets collision circle?
@@ -43,4 +44,12 @@ bool Rocket::intersects(vec2 position_other, float radius_other) const
     }
 }
 
+//Does the given circle collide with the circle swept from the previous to the current position?
+bool Rocket::intersects_swept(vec2 position_other, float radius_other) const
+{
+    //The segment test misses a circle that holds the whole segment, the end position test catches those
+    //(and rockets that didn't move, for which the segment test divides by zero)
+    return intersects(position_other, radius_other) || circle_segment_intersect(previous_position, position, position_other, collision_radius + radius_other);
+}
+
 } // namespace Tmpl8
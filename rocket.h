@@ -10,11 +10,14 @@ class Rocket : public movable
     ~Rocket();
 
     void tick();
-    void draw(Surface* screen);
+    void draw(DrawList& draw_list);
 
     bool intersects(vec2 position_other, float radius_other) const;
+    //Same, but along the whole way the rocket moved in its last tick, so fast rockets can't pass through
+    bool intersects_swept(vec2 position_other, float radius_other) const;
 
     vec2 position;
+    vec2 previous_position;
     vec2 speed;
 
     float collision_radius;
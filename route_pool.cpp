@@ -0,0 +1,26 @@
+#include "precomp.h"
+#include "route_pool.h"
+
+namespace Tmpl8
+{
+
+Route RoutePool::add(const vec2* points, const uint64_t* keys, size_t count)
+{
+    const uint32_t begin = (uint32_t)waypoints.size();
+    waypoints.insert(waypoints.end(), points, points + count);
+    const uint32_t end = (uint32_t)waypoints.size();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        routes.try_emplace(keys[i], Route{ begin + (uint32_t)i, end });
+    }
+    return { begin, end };
+}
+
+void RoutePool::clear()
+{
+    waypoints.clear();
+    routes.clear();
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Range of waypoints in a RoutePool, [begin, end)
+// -----------------------------------------------------------
+struct Route
+{
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    bool empty() const { return begin == end; }
+    uint32_t size() const { return end - begin; }
+};
+
+// -----------------------------------------------------------
+// All routes stored once, back to back in a single array of waypoints.
+// Routes are looked up by a key chosen by the owner (the terrain uses the start
+// and destination tile), and every tail of an added route is registered as the
+// route from that waypoint on, so tanks that start somewhere along a route that
+// was already found share its waypoints instead of storing a copy.
+// Tanks only keep indices into the pool, which stay valid when it grows.
+// Routes are never removed, the terrain doesn't change during a game.
+// Not thread safe, adding needs a lock and must not overlap with reading.
+// -----------------------------------------------------------
+class RoutePool
+{
+  public:
+    //The route stored under key, nullptr when there is none yet
+    const Route* find(uint64_t key) const
+    {
+        const auto it = routes.find(key);
+        return (it != routes.end()) ? &it->second : nullptr;
+    }
+
+    //Stores the waypoints and registers the route from waypoint i to the last one under keys[i]
+    //Keys that already have a route keep it, the returned route is the whole new one
+    Route add(const vec2* points, const uint64_t* keys, size_t count);
+
+    //Remembers that there is no route for key
+    void add_empty(uint64_t key) { routes.try_emplace(key, Route()); }
+
+    const vec2& operator[](uint32_t index) const { return waypoints[index]; }
+
+    void clear();
+
+    size_t waypoint_count() const { return waypoints.size(); }
+    size_t route_count() const { return routes.size(); }
+
+  private:
+    vector<vec2> waypoints;
+    std::unordered_map<uint64_t, Route> routes;
+};
+
+} // namespace Tmpl8
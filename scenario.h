@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+enum class SpawnLayout
+{
+    GRID, //Fixed columns and spacing, large armies grow past the bottom of the map
+    FIT   //Same block width, spacing shrinks until the army fits on the map
+};
+
+// -----------------------------------------------------------
+// Parameters of a simulation run, the defaults are the interactive game
+// -----------------------------------------------------------
+struct Scenario
+{
+    std::string name = "default";
+
+    int tanks_blue = 2048;
+    int tanks_red = 2048;
+
+    SpawnLayout layout = SpawnLayout::GRID;
+    int columns = 24;
+    float spacing = 7.5f;
+
+    std::string map = "assets/terrain.txt";
+    bool beams = true;
+
+    //Rockets move this many pixels per frame, and are hit tested along the way they moved (swept)
+    //instead of only at their new position, so fast rockets don't pass through tanks
+    float rocket_speed = 3.f;
+    bool swept_rockets = true;
+
+    //Keep the surviving tanks in spawn order when destroyed ones are removed, costs a pass over all tanks
+    bool stable_order = false;
+
+    int frames = 2000;
+    int threads = 0; //0 uses twice the hardware concurrency
+
+    //Only used by the benchmark runner
+    int repetitions = 5;
+};
+
+} // namespace Tmpl8
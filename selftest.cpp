@@ -0,0 +1,179 @@
+#include "precomp.h"
+#include "selftest.h"
+
+namespace Tmpl8
+{
+
+bool SelfTest::parse_arguments(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--selftest") == 0) return true;
+    }
+    return false;
+}
+
+void SelfTest::report(const char* name, int mismatches)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%-32s %s (%d mismatching pixels)", name, (mismatches == 0) ? "ok" : "FAILED", mismatches);
+    std::cout << line << std::endl;
+    if (mismatches != 0) failed++;
+}
+
+int SelfTest::run()
+{
+    std::mt19937 random(1234);
+    const auto random_int = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+    const auto random_pixel = [&]() { return (Pixel)random(); };
+    const auto count_mismatches = [](const Pixel* a, const Pixel* b, int count) {
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) mismatches += (a[i] != b[i]);
+        return mismatches;
+    };
+
+    // -----------------------------------------------------------
+    // Span operations, every start alignment and length, including the unaligned head and tail
+    // -----------------------------------------------------------
+    constexpr int span_size = 256;
+    vector<Pixel> source(span_size), expected(span_size), actual(span_size);
+    const auto randomise = [&](vector<Pixel>& pixels) {
+        for (Pixel& pixel : pixels) pixel = random_pixel();
+    };
+
+    //Random parameters of the operations, new ones every round
+    Pixel color = 0;
+    unsigned int scale = 0;
+
+    //Runs op and reference on the same random span, the pixels around the span must stay untouched
+    const auto check_spans = [&](const char* name, const std::function<void(Pixel*, const Pixel*, int)>& op,
+                                 const std::function<void(Pixel*, const Pixel*, int)>& reference) {
+        int mismatches = 0;
+        for (int round = 0; round < rounds; round++)
+        {
+            randomise(source);
+            randomise(expected);
+            actual = expected;
+            const int offset = random_int(0, 7), count = random_int(0, span_size - 8);
+            color = random_pixel();
+            scale = (unsigned int)random_int(0, 32);
+            reference(expected.data() + offset, source.data() + offset, count);
+            op(actual.data() + offset, source.data() + offset, count);
+            mismatches += count_mismatches(expected.data(), actual.data(), span_size);
+        }
+        report(name, mismatches);
+    };
+
+    check_spans(
+        "surface_ops::fill", [&](Pixel* dst, const Pixel*, int count) { surface_ops::fill(dst, count, color); },
+        [&](Pixel* dst, const Pixel*, int count) { surface_ops::fill_scalar(dst, count, color); });
+    check_spans(
+        "surface_ops::fill_stream", [&](Pixel* dst, const Pixel*, int count) { surface_ops::fill_stream(dst, count, color); _mm_sfence(); },
+        [&](Pixel* dst, const Pixel*, int count) { surface_ops::fill_scalar(dst, count, color); });
+    check_spans(
+        "surface_ops::copy_stream", [](Pixel* dst, const Pixel* src, int count) { surface_ops::copy_stream(dst, src, count); surface_ops::stream_fence(); },
+        [](Pixel* dst, const Pixel* src, int count) { memcpy(dst, src, count * sizeof(Pixel)); });
+    check_spans(
+        "surface_ops::add_blend", [](Pixel* dst, const Pixel* src, int count) { surface_ops::add_blend(dst, src, count); },
+        [](Pixel* dst, const Pixel* src, int count) { surface_ops::add_blend_scalar(dst, src, count); });
+    check_spans(
+        "surface_ops::scale_color", [&](Pixel* dst, const Pixel*, int count) { surface_ops::scale_color(dst, count, scale); },
+        [&](Pixel* dst, const Pixel*, int count) { surface_ops::scale_color_scalar(dst, count, scale); });
+
+    // -----------------------------------------------------------
+    // Surface operations, on a view into a larger buffer so rows don't start aligned
+    // and the pixels between the rows must stay untouched
+    // -----------------------------------------------------------
+    constexpr int buffer_width = 160, buffer_height = 100;
+    vector<Pixel> expected_buffer(buffer_width * buffer_height), actual_buffer(buffer_width * buffer_height);
+
+    //Calls test(expected, actual) on two views with the same random contents and position
+    const auto check_surfaces = [&](const char* name, const std::function<void(Surface&, Surface&)>& test) {
+        int mismatches = 0;
+        for (int round = 0; round < rounds; round++)
+        {
+            randomise(expected_buffer);
+            actual_buffer = expected_buffer;
+            const int x = random_int(0, 7), y = random_int(0, 7);
+            const int width = random_int(1, buffer_width - x), height = random_int(1, buffer_height - y);
+            Surface expected_view(width, height, expected_buffer.data() + x + y * buffer_width, buffer_width);
+            Surface actual_view(width, height, actual_buffer.data() + x + y * buffer_width, buffer_width);
+            test(expected_view, actual_view);
+            mismatches += count_mismatches(expected_buffer.data(), actual_buffer.data(), buffer_width * buffer_height);
+        }
+        report(name, mismatches);
+    };
+
+    check_surfaces("Surface::clear", [&](Surface& expected_view, Surface& actual_view) {
+        const Pixel color = random_pixel();
+        for (int y = 0; y < expected_view.get_height(); y++) surface_ops::fill_scalar(expected_view.get_buffer() + y * expected_view.get_pitch(), expected_view.get_width(), color);
+        actual_view.clear(color);
+    });
+
+    check_surfaces("Surface::bar", [&](Surface& expected_view, Surface& actual_view) {
+        //Bars aren't clipped, callers pass corners inside the surface
+        const int x1 = random_int(0, expected_view.get_width() - 1), x2 = random_int(x1, expected_view.get_width() - 1);
+        const int y1 = random_int(0, expected_view.get_height() - 1), y2 = random_int(y1, expected_view.get_height() - 1);
+        const Pixel color = random_pixel();
+        for (int y = y1; y <= y2; y++) surface_ops::fill_scalar(expected_view.get_buffer() + x1 + y * expected_view.get_pitch(), x2 - x1 + 1, color);
+        actual_view.bar(x1, y1, x2, y2, color);
+    });
+
+    check_surfaces("Surface::box", [&](Surface& expected_view, Surface& actual_view) {
+        //Boxes are clipped, so the corners may be anywhere and in any order
+        const int x1 = random_int(-20, expected_view.get_width() + 20), x2 = random_int(-20, expected_view.get_width() + 20);
+        const int y1 = random_int(-20, expected_view.get_height() + 20), y2 = random_int(-20, expected_view.get_height() + 20);
+        const Pixel color = random_pixel();
+        const int left = std::min(x1, x2), right = std::max(x1, x2), top = std::min(y1, y2), bottom = std::max(y1, y2);
+        for (int y = 0; y < expected_view.get_height(); y++)
+        {
+            for (int x = 0; x < expected_view.get_width(); x++)
+            {
+                const bool on_row = (y == top || y == bottom) && x >= left && x <= right;
+                const bool on_column = (x == left || x == right) && y >= top && y <= bottom;
+                if (on_row || on_column) expected_view.get_buffer()[x + y * expected_view.get_pitch()] = color;
+            }
+        }
+        actual_view.box(x1, y1, x2, y2, color);
+    });
+
+    check_surfaces("Surface::blend_copy_to", [&](Surface& expected_view, Surface& actual_view) {
+        //Source anywhere around the target, it is clipped against it
+        Surface source_surface(random_int(1, 64), random_int(1, 64));
+        for (int i = 0; i < source_surface.get_width() * source_surface.get_height(); i++) source_surface.get_buffer()[i] = random_pixel();
+        const int x = random_int(-source_surface.get_width(), expected_view.get_width());
+        const int y = random_int(-source_surface.get_height(), expected_view.get_height());
+        for (int sy = 0; sy < source_surface.get_height(); sy++)
+        {
+            for (int sx = 0; sx < source_surface.get_width(); sx++)
+            {
+                const int dx = x + sx, dy = y + sy;
+                if (dx < 0 || dy < 0 || dx >= expected_view.get_width() || dy >= expected_view.get_height()) continue;
+                surface_ops::add_blend_scalar(expected_view.get_buffer() + dx + dy * expected_view.get_pitch(), source_surface.get_buffer() + sx + sy * source_surface.get_pitch(), 1);
+            }
+        }
+        source_surface.blend_copy_to(&actual_view, x, y);
+    });
+
+    //Scales the whole buffer of the surface (pitch times height), so it gets a surface of its own
+    {
+        int mismatches = 0;
+        for (int round = 0; round < rounds; round++)
+        {
+            Surface surface(random_int(1, buffer_width), random_int(1, buffer_height));
+            const int count = surface.get_pitch() * surface.get_height();
+            for (int i = 0; i < count; i++) surface.get_buffer()[i] = random_pixel();
+            vector<Pixel> expected_pixels(surface.get_buffer(), surface.get_buffer() + count);
+            const unsigned int scale = (unsigned int)random_int(0, 32);
+            surface_ops::scale_color_scalar(expected_pixels.data(), count, scale);
+            surface.scale_color(scale);
+            mismatches += count_mismatches(expected_pixels.data(), surface.get_buffer(), count);
+        }
+        report("Surface::scale_color", mismatches);
+    }
+
+    std::cout << ((failed == 0) ? "All self tests passed" : "Self tests FAILED") << std::endl;
+    return (failed == 0) ? 0 : 1;
+}
+
+} // namespace Tmpl8
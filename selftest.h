@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Checks the SIMD surface operations against their scalar reference
+// versions on randomised spans and rectangles, without opening a window.
+//
+//   --selftest   run all checks, the exit code is 1 when any pixel differs
+//
+// Span operations are compared with surface_ops::*_scalar at every alignment,
+// the Surface operations (clear, bar, box, scale_color, blend_copy_to) with
+// a pixel by pixel reference, also on views whose pitch is wider than a row.
+// -----------------------------------------------------------
+class SelfTest
+{
+  public:
+    //Returns false when --selftest isn't on the command line
+    bool parse_arguments(int argc, char** argv);
+
+    //Runs the checks, returns the exit code for the process
+    int run();
+
+  private:
+    static constexpr int rounds = 500;
+
+    //Prints the result of one check and counts it when it failed
+    void report(const char* name, int mismatches);
+
+    int failed = 0;
+};
+
+} // namespace Tmpl8
@@ -8,7 +8,9 @@ namespace Tmpl8
 
 void NotifyUser(const char* s);
 char Surface::s_Font[51][5][6];
+uint8_t Surface::s_FontMask[51][5];
 bool Surface::fontInitialized = false;
+int Surface::s_Transl[256];
 
 // -----------------------------------------------------------
 // True-color surface class implementation
@@ -78,8 +80,15 @@ Surface::~Surface()
 
 void Surface::clear(Pixel a_Color)
 {
-    int s = m_Width * m_Height;
-    for (int i = 0; i < s; i++) m_Buffer[i] = a_Color;
+    if (m_Pitch == m_Width)
+    {
+        // contiguous: one streamed fill, the cleared buffer won't be read again soon
+        surface_ops::fill_stream(m_Buffer, m_Width * m_Height, a_Color);
+    }
+    else
+    {
+        for (int y = 0; y < m_Height; y++) surface_ops::fill(m_Buffer + y * m_Pitch, m_Width, a_Color);
+    }
 }
 
 void Surface::centre(const char* a_String, int y1, Pixel color)
@@ -96,7 +105,8 @@ void Surface::print(const char* a_String, int x1, int y1, Pixel color)
         fontInitialized = true;
     }
     Pixel* t = m_Buffer + x1 + y1 * m_Pitch;
-    for (int i = 0; i < (int)(strlen(a_String)); i++, t += 6)
+    const int length = (int)strlen(a_String);
+    for (int i = 0; i < length; i++, t += 6)
     {
         int pos = 0;
         if ((a_String[i] >= 'A') && (a_String[i] <= 'Z'))
@@ -104,10 +114,9 @@ void Surface::print(const char* a_String, int x1, int y1, Pixel color)
         else
             pos = s_Transl[(unsigned short)a_String[i]];
         Pixel* a = t;
-        const char* c = (const char*)s_Font[pos];
-        for (int v = 0; v < 5; v++, c++, a += m_Pitch)
-            for (int h = 0; h < 5; h++)
-                if (*c++ == 'o') *(a + h) = color, *(a + h + m_Pitch) = 0;
+        for (int v = 0; v < 5; v++, a += m_Pitch)
+            for (unsigned int bits = s_FontMask[pos][v], h = 0; bits; bits >>= 1, h++)
+                if (bits & 1) *(a + h) = color, *(a + h + m_Pitch) = 0;
     }
 }
 
@@ -141,9 +150,17 @@ void Surface::resize(Surface* a_Orig)
 #define OUTCODE(x, y) (((x) < xmin) ? 1 : (((x) > xmax) ? 2 : 0)) + (((y) < ymin) ? 4 : (((y) > ymax) ? 8 : 0))
 
 void Surface::line(float x1, float y1, float x2, float y2, Pixel c)
+{
+    line(x1, y1, x2, y2, c, m_Width, m_Height, 0, 0);
+}
+
+// Same as line() on a frame of frame_width by frame_height pixels, of which this surface holds the part
+// at (origin_x, origin_y). The line is clipped against the whole frame, so it steps over exactly the
+// same pixels no matter which part of it is drawn. Used by the tile renderer to draw a line tile by tile.
+void Surface::line(float x1, float y1, float x2, float y2, Pixel c, int frame_width, int frame_height, int origin_x, int origin_y)
 {
     // clip (Cohen-Sutherland, https://en.wikipedia.org/wiki/Cohen%E2%80%93Sutherland_algorithm)
-    const float xmin = 0, ymin = 0, xmax = (float)m_Width - 1, ymax = (float)m_Height - 1;
+    const float xmin = 0, ymin = 0, xmax = (float)frame_width - 1, ymax = (float)frame_height - 1;
     int c0 = OUTCODE(x1, y1), c1 = OUTCODE(x2, y2);
     bool accept = false;
     while (1)
@@ -165,7 +182,7 @@ void Surface::line(float x1, float y1, float x2, float y2, Pixel c)
                 x = x1 + (x2 - x1) * (ymin - y1) / (y2 - y1), y = ymin;
             else if (co & 2)
                 y = y1 + (y2 - y1) * (xmax - x1) / (x2 - x1), x = xmax;
-            else if (co & 1)
+            else //co & 1, co is never 0 here
                 y = y1 + (y2 - y1) * (xmin - x1) / (x2 - x1), x = xmin;
             if (co == c0)
                 x1 = x, y1 = y, c0 = OUTCODE(x1, y1);
@@ -183,7 +200,8 @@ void Surface::line(float x1, float y1, float x2, float y2, Pixel c)
     float dy = h / (float)l;
     for (int i = 0; i <= il; i++)
     {
-        *(m_Buffer + (int)x1 + (int)y1 * m_Pitch) = c;
+        const int px = (int)x1 - origin_x, py = (int)y1 - origin_y;
+        if ((px >= 0) && (px < m_Width) && (py >= 0) && (py < m_Height)) *(m_Buffer + px + py * m_Pitch) = c;
         x1 += dx, y1 += dy;
     }
 }
@@ -199,12 +217,21 @@ void Surface::plot(int x, int y, Pixel c)
         m_Buffer[x + y * m_Pitch] = c;
 }
 
+// draws the same pixels as four clipped lines, but fills the rows and columns directly
 void Surface::box(int x1, int y1, int x2, int y2, Pixel c)
 {
-    line((float)x1, (float)y1, (float)x2, (float)y1, c);
-    line((float)x2, (float)y1, (float)x2, (float)y2, c);
-    line((float)x1, (float)y2, (float)x2, (float)y2, c);
-    line((float)x1, (float)y1, (float)x1, (float)y2, c);
+    const int left = std::min(x1, x2), right = std::max(x1, x2);
+    const int top = std::min(y1, y2), bottom = std::max(y1, y2);
+    const int cx1 = std::max(left, 0), cx2 = std::min(right, m_Width - 1);
+    const int cy1 = std::max(top, 0), cy2 = std::min(bottom, m_Height - 1);
+    if ((cx1 > cx2) || (cy1 > cy2)) return;
+    if (top >= 0) surface_ops::fill(m_Buffer + cx1 + top * m_Pitch, cx2 - cx1 + 1, c);
+    if (bottom < m_Height) surface_ops::fill(m_Buffer + cx1 + bottom * m_Pitch, cx2 - cx1 + 1, c);
+    for (int y = cy1; y <= cy2; y++)
+    {
+        if (left >= 0) m_Buffer[left + y * m_Pitch] = c;
+        if (right < m_Width) m_Buffer[right + y * m_Pitch] = c;
+    }
 }
 
 void Surface::bar(int x1, int y1, int x2, int y2, Pixel c)
@@ -212,7 +239,7 @@ void Surface::bar(int x1, int y1, int x2, int y2, Pixel c)
     Pixel* a = x1 + y1 * m_Pitch + m_Buffer;
     for (int y = y1; y <= y2; y++)
     {
-        for (int x = 0; x <= (x2 - x1); x++) a[x] = c;
+        surface_ops::fill(a, x2 - x1 + 1, c);
         a += m_Pitch;
     }
 }
@@ -267,7 +294,7 @@ void Surface::blend_copy_to(Surface* a_Dst, int a_X, int a_Y)
             dst += a_X + dstpitch * a_Y;
             for (int y = 0; y < srcheight; y++)
             {
-                for (int x = 0; x < srcwidth; x++) dst[x] = add_blend(dst[x], src[x]);
+                surface_ops::add_blend(dst, src, srcwidth);
                 dst += dstpitch;
                 src += srcpitch;
             }
@@ -340,18 +367,18 @@ void Surface::init_charset()
     int i;
     for (i = 0; i < 256; i++) s_Transl[i] = 45;
     for (i = 0; i < 50; i++) s_Transl[(unsigned char)c[i]] = i;
+    for (i = 0; i < 51; i++)
+        for (int v = 0; v < 5; v++)
+        {
+            s_FontMask[i][v] = 0;
+            for (int h = 0; h < 5; h++)
+                if (s_Font[i][v][h] == 'o') s_FontMask[i][v] |= 1 << h;
+        }
 }
 
 void Surface::scale_color(unsigned int a_Scale)
 {
-    int s = m_Pitch * m_Height;
-    for (int i = 0; i < s; i++)
-    {
-        Pixel c = m_Buffer[i];
-        unsigned int rb = (((c & (REDMASK | BLUEMASK)) * a_Scale) >> 5) & (REDMASK | BLUEMASK);
-        unsigned int g = (((c & GREENMASK) * a_Scale) >> 5) & GREENMASK;
-        m_Buffer[i] = rb + g;
-    }
+    surface_ops::scale_color(m_Buffer, m_Pitch * m_Height, a_Scale);
 }
 
 Sprite::Sprite(Surface* a_Surface, unsigned int a_NumFrames) : m_Width(a_Surface->get_width() / a_NumFrames),
@@ -364,16 +391,27 @@ Sprite::Sprite(Surface* a_Surface, unsigned int a_NumFrames) : m_Width(a_Surface
                                                                m_Surface(a_Surface)
 {
     initialize_start_data();
+    m_Id = (unsigned int)registry().size();
+    registry().push_back(this);
 }
 
 Sprite::~Sprite()
 {
-    for (unsigned int i = 0; i < m_NumFrames; i++) delete m_Start[i];
-    delete m_Start;
+    registry()[m_Id] = nullptr;
+    for (unsigned int i = 0; i < m_NumFrames; i++) delete[] m_Start[i];
+    delete[] m_Start;
 }
 
 void Sprite::draw(Surface* a_Target, int a_X, int a_Y)
 {
+    draw_frame(a_Target, a_X, a_Y, m_CurrentFrame);
+}
+
+//Draw the given frame without touching the current frame, so one sprite can be drawn from several threads at once
+//a_Flags are combined with the sprite's own flags for this draw only
+void Sprite::draw_frame(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame, unsigned int a_Flags)
+{
+    const unsigned int flags = m_Flags | a_Flags;
     //If out of screen skip
     if ((a_X < -m_Width) || (a_X > (a_Target->get_width() + m_Width))) return;
     if ((a_Y < -m_Height) || (a_Y > (a_Target->get_height() + m_Height))) return;
@@ -383,7 +421,7 @@ void Sprite::draw(Surface* a_Target, int a_X, int a_Y)
     int y1 = a_Y, y2 = a_Y + m_Height;
 
     //Image start
-    Pixel* src = get_buffer() + m_CurrentFrame * m_Width;
+    Pixel* src = get_buffer() + a_Frame * m_Width;
     //Set start x to within screen
     if (x1 < 0)
     {
@@ -409,8 +447,8 @@ void Sprite::draw(Surface* a_Target, int a_X, int a_Y)
         for (int y = 0; y < height; y++)
         {
             const int line = y + (y1 - a_Y);
-            const int lsx = m_Start[m_CurrentFrame][line] + a_X;
-            if (m_Flags & FLARE)
+            const int lsx = m_Start[a_Frame][line] + a_X;
+            if (flags & FLARE)
             {
                 xs = (lsx > x1) ? lsx - x1 : 0;
                 for (int x = xs; x < width; x++)
@@ -438,47 +476,100 @@ void Sprite::draw(Surface* a_Target, int a_X, int a_Y)
     }
 }
 
-void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target)
+void Sprite::draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, bool a_Bilinear)
 {
-    if ((a_Width == 0) || (a_Height == 0)) return;
-    if ((a_X < -a_Width) || (a_X > (a_Target->get_width() + a_Width))) return;
-    if ((a_Y < -a_Height) || (a_Y > (a_Target->get_height() + a_Height))) return;
+    draw_scaled_frame(a_X, a_Y, a_Width, a_Height, a_Target, m_CurrentFrame, a_Bilinear);
+}
 
-    //Get start and end points
-    int x1 = a_X;
-    int x2 = a_X + a_Width;
-    int y1 = a_Y;
-    int y2 = a_Y + a_Height;
+// Scaled blit, walks the target row by row and steps through the source with 32.32 fixed point.
+// The step is rounded up, which makes the stepping exact for target sizes below 65536 pixels.
+// With a_Bilinear the four nearest texels are blended like Surface::resize does; transparent
+// texels are replaced by the nearest one so the sprite doesn't get a dark outline.
+// Flags work like in draw_frame: with FLARE the texels are added to the target instead of copied.
+void Sprite::draw_scaled_frame(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, unsigned int a_Frame, bool a_Bilinear, unsigned int a_Flags)
+{
+    if ((a_Width <= 0) || (a_Height <= 0)) return;
+    const bool flare = ((m_Flags | a_Flags) & FLARE) != 0;
 
-    int x_start = 0;
-    int x_end = a_Width;
-    int y_start = 0;
-    int y_end = a_Height;
+    //Clip against the target
+    const int x_start = std::max(0, -a_X);
+    const int x_end = std::min(a_Width, a_Target->get_width() - a_X);
+    const int y_start = std::max(0, -a_Y);
+    const int y_end = std::min(a_Height, a_Target->get_height() - a_Y);
+    if ((x_start >= x_end) || (y_start >= y_end)) return;
 
-    //Set start x to within screen
-    if (x1 < 0)
-    {
-        x_start += -x1;
-    }
-    //Set end x to within screen
-    if (x2 > a_Target->get_width()) x_end = a_Width - (x2 - a_Target->get_width());
-    if (y1 < 0)
-    {
-        y_start += -y1;
-    }
-    if (y2 > a_Target->get_height()) y_end = a_Height - (y2 - a_Target->get_height());
+    const uint64_t du = (((uint64_t)m_Width << 32) + a_Width - 1) / a_Width;
+    const uint64_t dv = (((uint64_t)m_Height << 32) + a_Height - 1) / a_Height;
 
-    for (int x = x_start; x < x_end; x++)
+    const Pixel* src = get_buffer() + a_Frame * m_Width;
+    const int dpitch = a_Target->get_pitch();
+    Pixel* dst = a_Target->get_buffer() + a_X + (a_Y + y_start) * dpitch;
+
+    uint64_t v = dv * y_start;
+    for (int y = y_start; y < y_end; y++, v += dv, dst += dpitch)
     {
-        for (int y = y_start; y < y_end; y++)
+        const int sv = (int)(v >> 32);
+        const Pixel* line = src + sv * m_Pitch;
+        uint64_t u = du * x_start;
+        int x = x_start;
+
+        if (a_Bilinear)
         {
-            int u = (int)((float)x * ((float)m_Width / (float)a_Width)) + m_CurrentFrame * m_Width;
-            int v = (int)((float)y * ((float)m_Height / (float)a_Height));
-            Pixel color = get_buffer()[u + v * m_Pitch];
-            if (color & 0xffffff)
+            //Neighbouring texels, clamped to the frame
+            const Pixel* next_line = (sv + 1 < m_Height) ? line + m_Pitch : line;
+            const int vfrac = (int)(v >> 22) & 1023;
+            for (; x < x_end; x++, u += du)
             {
-                a_Target->get_buffer()[a_X + x + ((a_Y + y) * a_Target->get_pitch())] = color;
+                const int su = (int)(u >> 32);
+                const Pixel p1 = line[su];
+                if (!(p1 & 0xffffff)) continue;
+                const int su2 = (su + 1 < m_Width) ? su + 1 : su;
+                Pixel p2 = line[su2], p3 = next_line[su], p4 = next_line[su2];
+                if (!(p2 & 0xffffff)) p2 = p1;
+                if (!(p3 & 0xffffff)) p3 = p1;
+                if (!(p4 & 0xffffff)) p4 = p1;
+                const int ufrac = (int)(u >> 22) & 1023;
+                const int w4 = (ufrac * vfrac) >> 12;
+                const int w3 = ((1023 - ufrac) * vfrac) >> 12;
+                const int w2 = (ufrac * (1023 - vfrac)) >> 12;
+                const int w1 = ((1023 - ufrac) * (1023 - vfrac)) >> 12;
+                const unsigned int r = (((p1 & REDMASK) * w1 + (p2 & REDMASK) * w2 + (p3 & REDMASK) * w3 + (p4 & REDMASK) * w4) >> 8) & REDMASK;
+                const unsigned int g = (((p1 & GREENMASK) * w1 + (p2 & GREENMASK) * w2 + (p3 & GREENMASK) * w3 + (p4 & GREENMASK) * w4) >> 8) & GREENMASK;
+                const unsigned int b = (((p1 & BLUEMASK) * w1 + (p2 & BLUEMASK) * w2 + (p3 & BLUEMASK) * w3 + (p4 & BLUEMASK) * w4) >> 8) & BLUEMASK;
+                dst[x] = flare ? add_blend(r + g + b, dst[x]) : r + g + b;
             }
+            continue;
+        }
+
+        if (flare)
+        {
+            for (; x < x_end; x++, u += du)
+            {
+                const Pixel c = line[(int)(u >> 32)];
+                if (c & 0xffffff) dst[x] = add_blend(c, dst[x]);
+            }
+            continue;
+        }
+
+        //Nearest: four texels at a time, transparent texels keep the destination pixel
+        const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= x_end; x += 4)
+        {
+            const Pixel c0 = line[(int)(u >> 32)];
+            const Pixel c1 = line[(int)((u + du) >> 32)];
+            const Pixel c2 = line[(int)((u + 2 * du) >> 32)];
+            const Pixel c3 = line[(int)((u + 3 * du) >> 32)];
+            u += 4 * du;
+            const __m128i c = _mm_set_epi32((int)c3, (int)c2, (int)c1, (int)c0);
+            const __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(c, rgb), zero);
+            const __m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, c)));
+        }
+        for (; x < x_end; x++, u += du)
+        {
+            const Pixel c = line[(int)(u >> 32)];
+            if (c & 0xffffff) dst[x] = c;
         }
     }
 }
@@ -519,6 +610,8 @@ Font::Font(const char* a_File, const char* a_Chars)
     m_Width = new int[strlen(a_Chars)];
     m_Height = h;
     m_CY1 = 0, m_CY2 = 1024;
+    m_Id = (unsigned int)registry().size();
+    registry().push_back(this);
     int x, y;
     bool lastempty = true;
     for (x = 0; x < w; x++)
@@ -538,14 +631,39 @@ Font::Font(const char* a_File, const char* a_Chars)
         }
         lastempty = empty;
     }
+
+    //Precompute the non-transparent runs of every glyph row
+    m_SpanStart.assign(strlen(a_Chars) + 1, 0);
+    for (unsigned int c = 0; c < strlen(a_Chars); c++)
+    {
+        m_SpanStart[c] = (int)m_Spans.size();
+        if (c >= charnr) continue;
+        for (y = 0; y < h; y++)
+        {
+            const Pixel* row = b + m_Offset[c] + y * w;
+            for (x = 0; x < m_Width[c];)
+            {
+                if (!row[x])
+                {
+                    x++;
+                    continue;
+                }
+                const int start = x;
+                while ((x < m_Width[c]) && row[x]) x++;
+                m_Spans.push_back({ (uint16_t)y, (uint16_t)start, (uint16_t)(x - start) });
+            }
+        }
+    }
+    m_SpanStart[strlen(a_Chars)] = (int)m_Spans.size();
 }
 
 Font::~Font()
 {
+    if (m_Surface) registry()[m_Id] = nullptr;
     delete m_Surface;
-    delete m_Trans;
-    delete m_Width;
-    delete m_Offset;
+    delete[] m_Trans;
+    delete[] m_Width;
+    delete[] m_Offset;
 }
 
 int Font::width(const char* a_Text)
@@ -569,48 +687,69 @@ void Font::centre(Surface* a_Target, const char* a_Text, int a_Y)
     print(a_Target, a_Text, x, a_Y);
 }
 
-void Font::print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, bool clip)
+void Font::print(Surface* a_Target, const char* a_Text, int a_X, int a_Y)
 {
-    Pixel* b = a_Target->get_buffer() + a_X + a_Y * a_Target->get_pitch();
-    Pixel* s = m_Surface->get_buffer();
-    unsigned int i, cx;
-    int x, y;
     if (((a_Y + m_Height) < m_CY1) || (a_Y > m_CY2)) return;
-    for (cx = 0, i = 0; i < strlen(a_Text); i++)
+    const int length = (int)strlen(a_Text);
+    for (int cx = 0, i = 0; i < length; i++)
     {
         if (a_Text[i] == ' ')
             cx += 4;
         else
         {
             int c = m_Trans[(unsigned char)a_Text[i]];
-            Pixel *t = s + m_Offset[c], *d = b + cx;
-            if (clip)
-            {
-                for (y = 0; y < m_Height; y++)
-                {
-                    if (((a_Y + y) >= m_CY1) && ((a_Y + y) <= m_CY2))
-                    {
-                        for (x = 0; x < m_Width[c]; x++)
-                            if ((t[x]) && ((x + (int)cx + a_X) < a_Target->get_pitch()))
-                                d[x] = add_blend(t[x], d[x]);
-                    }
-                    t += m_Surface->get_pitch(), d += a_Target->get_pitch();
-                }
-            }
-            else
-            {
-                for (y = 0; y < m_Height; y++)
-                {
-                    if (((a_Y + y) >= m_CY1) && ((a_Y + y) <= m_CY2))
-                        for (x = 0; x < m_Width[c]; x++)
-                            if (t[x]) d[x] = add_blend(t[x], d[x]);
-                    t += m_Surface->get_pitch(), d += a_Target->get_pitch();
-                }
-            }
+            draw_glyph(a_Target, c, a_X + cx, a_Y);
+            cx += m_Width[c] + 2;
+            if ((cx + a_X) >= a_Target->get_pitch()) break;
+        }
+    }
+}
+
+int Font::layout(const char* a_Text, int a_X, int a_Y, vector<Glyph>& a_Glyphs) const
+{
+    int cx = 0;
+    for (const char* p = a_Text; *p; p++)
+    {
+        if (*p == ' ')
+            cx += 4;
+        else
+        {
+            int c = m_Trans[(unsigned char)*p];
+            a_Glyphs.push_back({ a_X + cx, a_Y, c });
             cx += m_Width[c] + 2;
-            if ((int)(cx + a_X) >= a_Target->get_pitch()) break;
         }
     }
+    return cx;
+}
+
+void Font::draw(Surface* a_Target, const vector<Glyph>& a_Glyphs) const
+{
+    for (const Glyph& glyph : a_Glyphs)
+    {
+        draw_glyph(a_Target, glyph.index, glyph.x, glyph.y);
+    }
+}
+
+// Add the glyph's spans to the target, clipped to the target and the y_clip range
+void Font::draw_glyph(Surface* a_Target, int a_Glyph, int a_X, int a_Y, int a_OriginX, int a_OriginY) const
+{
+    const Pixel* s = m_Surface->get_buffer() + m_Offset[a_Glyph];
+    const int y1 = std::max(m_CY1, a_OriginY), y2 = std::min(m_CY2, a_OriginY + a_Target->get_height() - 1);
+    if ((a_Y + m_Height <= y1) || (a_Y > y2)) return;
+
+    for (int i = m_SpanStart[a_Glyph]; i < m_SpanStart[a_Glyph + 1]; i++)
+    {
+        const Span& span = m_Spans[i];
+        const int y = a_Y + span.row;
+        if ((y < y1) || (y > y2)) continue;
+
+        const int x1 = std::max(a_X + span.start, a_OriginX);
+        const int x2 = std::min(a_X + span.start + span.length, a_OriginX + a_Target->get_width());
+        if (x1 >= x2) continue;
+
+        Pixel* d = a_Target->get_buffer() + (x1 - a_OriginX) + (y - a_OriginY) * a_Target->get_pitch();
+        surface_ops::add_blend(d, s + (x1 - a_X) + span.row * m_Surface->get_pitch(), x2 - x1);
+    }
 }
 
 }; // namespace Tmpl8
@@ -71,6 +71,7 @@ class Surface
     void clear(Pixel a_Color);
     void line(float x1, float y1, float x2, float y2, Pixel color);
     void line(vec2 start, vec2 end, Pixel color);
+    void line(float x1, float y1, float x2, float y2, Pixel color, int frame_width, int frame_height, int origin_x, int origin_y);
     void plot(int x, int y, Pixel c);
     void load_image(const char* a_File);
     void copy_to(Surface* a_Dst, int a_X, int a_Y);
@@ -88,8 +89,10 @@ class Surface
     int m_Flags;
     // Static attributes for the builtin font
     static char s_Font[51][5][6];
+    //Bit h of s_FontMask[c][v] is set when s_Font[c][v][h] is 'o'
+    static uint8_t s_FontMask[51][5];
     static bool fontInitialized;
-    int s_Transl[256];
+    static int s_Transl[256];
 };
 
 class Sprite
@@ -115,7 +118,9 @@ class Sprite
     ~Sprite();
     // Methods
     void draw(Surface* a_Target, int a_X, int a_Y);
-    void draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target);
+    void draw_frame(Surface* a_Target, int a_X, int a_Y, unsigned int a_Frame, unsigned int a_Flags = 0);
+    void draw_scaled(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, bool a_Bilinear = false);
+    void draw_scaled_frame(int a_X, int a_Y, int a_Width, int a_Height, Surface* a_Target, unsigned int a_Frame, bool a_Bilinear = false, unsigned int a_Flags = 0);
     void set_flags(unsigned int a_Flags) { m_Flags = a_Flags; }
     void set_frame(unsigned int a_Index) { m_CurrentFrame = a_Index; }
     unsigned int get_flags() const { return m_Flags; }
@@ -125,6 +130,9 @@ class Sprite
     unsigned int frames() { return m_NumFrames; }
     Surface* get_surface() { return m_Surface; }
     void initialize_start_data();
+    // Every sprite gets a small id on construction, so draw commands don't need to store pointers
+    unsigned int get_id() const { return m_Id; }
+    static Sprite* from_id(unsigned int a_Id) { return registry()[a_Id]; }
 
   private:
     // Attributes
@@ -134,6 +142,13 @@ class Sprite
     unsigned int m_Flags;
     unsigned int** m_Start;
     Surface* m_Surface;
+    unsigned int m_Id;
+    // Function local so sprites can be created during static initialization
+    static vector<Sprite*>& registry()
+    {
+        static vector<Sprite*> sprites;
+        return sprites;
+    }
 };
 
 class Font
@@ -142,7 +157,8 @@ class Font
     Font(){};
     Font(const char* a_File, const char* a_Chars);
     ~Font();
-    void print(Surface* a_Target, const char* a_Text, int a_X, int a_Y, bool clip = false);
+    //Text is always clipped to the target and the y_clip range
+    void print(Surface* a_Target, const char* a_Text, int a_X, int a_Y);
     void centre(Surface* a_Target, const char* a_Text, int a_Y);
     int width(const char* a_Text);
     int height() { return m_Surface->get_height(); }
@@ -152,7 +168,40 @@ class Font
         m_CY2 = y2;
     }
 
+    //A glyph placed by layout(), so many strings can be laid out first and drawn in one go
+    struct Glyph
+    {
+        int x, y;
+        int index;
+    };
+    //Append the glyphs of a_Text at (a_X, a_Y) to a_Glyphs, returns the width of the text
+    int layout(const char* a_Text, int a_X, int a_Y, vector<Glyph>& a_Glyphs) const;
+    void draw(Surface* a_Target, const vector<Glyph>& a_Glyphs) const;
+    //Draw one glyph to a target that holds the part of the screen at (a_OriginX, a_OriginY), such as a tile
+    //(a_X, a_Y) and the y_clip range are in screen coordinates
+    void draw_glyph(Surface* a_Target, int a_Glyph, int a_X, int a_Y, int a_OriginX = 0, int a_OriginY = 0) const;
+    int glyph_width(int a_Glyph) const { return m_Width[a_Glyph]; }
+    // Every font loaded from a file gets a small id, so draw commands don't need to store pointers
+    unsigned int get_id() const { return m_Id; }
+    static Font* from_id(unsigned int a_Id) { return registry()[a_Id]; }
+
   private:
+    // Function local so fonts can be created during static initialization
+    static vector<Font*>& registry()
+    {
+        static vector<Font*> fonts;
+        return fonts;
+    }
+
+    //Runs of non-transparent pixels in a glyph row, precomputed so drawing doesn't test every pixel
+    struct Span
+    {
+        uint16_t row, start, length;
+    };
+    //Glyph c uses m_Spans[m_SpanStart[c]] up to m_Spans[m_SpanStart[c + 1]]
+    vector<Span> m_Spans;
+    vector<int> m_SpanStart;
+
     Surface* m_Surface = nullptr;
     int* m_Offset = nullptr;
     int* m_Width = nullptr;
@@ -160,6 +209,7 @@ class Font
     int m_Height = 0;
     int m_CY1 = 0;
     int m_CY2 = 0;
+    unsigned int m_Id = 0;
 };
 
 }; // namespace Tmpl8
@@ -0,0 +1,143 @@
+// Template, UU version
+// IGAD/NHTV/UU - Jacco Bikker - 2006-2019
+
+#include "precomp.h"
+#include "surface_ops.h"
+
+namespace Tmpl8
+{
+namespace surface_ops
+{
+
+//Number of pixels before dst is 16 byte aligned (pixels are always 4 byte aligned)
+static inline int pixels_to_alignment(const Pixel* dst, int count)
+{
+    const int head = (int)(((16 - ((uintptr_t)dst & 15)) & 15) / sizeof(Pixel));
+    return std::min(head, count);
+}
+
+void fill_scalar(Pixel* dst, int count, Pixel color)
+{
+    for (int i = 0; i < count; i++) dst[i] = color;
+}
+
+void fill(Pixel* dst, int count, Pixel color)
+{
+    const int head = pixels_to_alignment(dst, count);
+    fill_scalar(dst, head, color);
+    int i = head;
+
+    const __m128i c4 = _mm_set1_epi32((int)color);
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm_store_si128((__m128i*)(dst + i), c4);
+        _mm_store_si128((__m128i*)(dst + i + 4), c4);
+        _mm_store_si128((__m128i*)(dst + i + 8), c4);
+        _mm_store_si128((__m128i*)(dst + i + 12), c4);
+    }
+    for (; i + 4 <= count; i += 4) _mm_store_si128((__m128i*)(dst + i), c4);
+
+    fill_scalar(dst + i, count - i, color);
+}
+
+void fill_stream(Pixel* dst, int count, Pixel color)
+{
+    const int head = pixels_to_alignment(dst, count);
+    fill_scalar(dst, head, color);
+    int i = head;
+
+    const __m128i c4 = _mm_set1_epi32((int)color);
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm_stream_si128((__m128i*)(dst + i), c4);
+        _mm_stream_si128((__m128i*)(dst + i + 4), c4);
+        _mm_stream_si128((__m128i*)(dst + i + 8), c4);
+        _mm_stream_si128((__m128i*)(dst + i + 12), c4);
+    }
+    for (; i + 4 <= count; i += 4) _mm_stream_si128((__m128i*)(dst + i), c4);
+    //Make the streamed stores visible before anyone reads the buffer
+    _mm_sfence();
+
+    fill_scalar(dst + i, count - i, color);
+}
+
+void copy_stream(Pixel* dst, const Pixel* src, int count)
+{
+    const int head = pixels_to_alignment(dst, count);
+    memcpy(dst, src, head * sizeof(Pixel));
+    int i = head;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm_stream_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+        _mm_stream_si128((__m128i*)(dst + i + 4), _mm_loadu_si128((const __m128i*)(src + i + 4)));
+    }
+    for (; i + 4 <= count; i += 4) _mm_stream_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+
+    memcpy(dst + i, src + i, (count - i) * sizeof(Pixel));
+}
+
+void stream_fence()
+{
+    _mm_sfence();
+}
+
+void add_blend_scalar(Pixel* dst, const Pixel* src, int count)
+{
+    for (int i = 0; i < count; i++) dst[i] = Tmpl8::add_blend(dst[i], src[i]);
+}
+
+void add_blend(Pixel* dst, const Pixel* src, int count)
+{
+    //add_blend saturates every color channel and clears alpha
+    const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(_mm_adds_epu8(a, b), rgb));
+    }
+    add_blend_scalar(dst + i, src + i, count - i);
+}
+
+void scale_color_scalar(Pixel* dst, int count, unsigned int scale)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const Pixel c = dst[i];
+        const unsigned int rb = (((c & (REDMASK | BLUEMASK)) * scale) >> 5) & (REDMASK | BLUEMASK);
+        const unsigned int g = (((c & GREENMASK) * scale) >> 5) & GREENMASK;
+        dst[i] = rb + g;
+    }
+}
+
+void scale_color(Pixel* dst, int count, unsigned int scale)
+{
+    //Up to 256 a channel times the scale fits in 16 bits and channels can't bleed into each other,
+    //so every channel is simply ((channel * scale) >> 5) & 255
+    if (scale > 256)
+    {
+        scale_color_scalar(dst, count, scale);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i scale8 = _mm_set1_epi16((short)scale);
+    const __m128i low_byte = _mm_set1_epi16(0xff);
+    const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i c = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_unpacklo_epi8(c, zero);
+        __m128i hi = _mm_unpackhi_epi8(c, zero);
+        lo = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(lo, scale8), 5), low_byte);
+        hi = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(hi, scale8), 5), low_byte);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(_mm_packus_epi16(lo, hi), rgb));
+    }
+    scale_color_scalar(dst + i, count - i, scale);
+}
+
+} // namespace surface_ops
+} // namespace Tmpl8
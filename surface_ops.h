@@ -0,0 +1,38 @@
+// Template, UU version
+// IGAD/NHTV/UU - Jacco Bikker - 2006-2019
+
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Span operations on pixel rows used by Surface.
+// The default versions use SSE2, the *_scalar versions are the
+// straightforward reference implementations the SIMD versions must
+// match pixel for pixel (they also handle the unaligned head and tail of a span).
+// -----------------------------------------------------------
+namespace surface_ops
+{
+//dst[0..count) = color
+void fill(Pixel* dst, int count, Pixel color);
+void fill_scalar(Pixel* dst, int count, Pixel color);
+
+//Same as fill, but uses non-temporal stores so large clears don't evict the cache
+void fill_stream(Pixel* dst, int count, Pixel color);
+
+//dst[0..count) = src[0..count) with non-temporal stores, for pixels that are written once and not read back
+//(such as finished tiles going to write-combined memory), call stream_fence() before anyone else reads dst
+void copy_stream(Pixel* dst, const Pixel* src, int count);
+void stream_fence();
+
+//dst[i] = add_blend(dst[i], src[i])
+void add_blend(Pixel* dst, const Pixel* src, int count);
+void add_blend_scalar(Pixel* dst, const Pixel* src, int count);
+
+//dst[i] = scale_color(dst[i], scale), scale is 5.5 fixed point (32 = 1.0)
+void scale_color(Pixel* dst, int count, unsigned int scale);
+void scale_color_scalar(Pixel* dst, int count, unsigned int scale);
+} // namespace surface_ops
+
+} // namespace Tmpl8
@@ -14,7 +14,8 @@ Tank::Tank(
     float tar_y,
     float collision_radius,
     int health,
-    float max_speed)
+    float max_speed,
+    HealthHistogram* health_histogram)
     : position(pos_x, pos_y),
       allignment(allignment),
       target(tar_x, tar_y),
@@ -28,9 +29,11 @@ Tank::Tank(
       active(true),
       current_frame(0),
       tank_sprite(tank_sprite),
-      smoke_sprite(smoke_sprite)
+      smoke_sprite(smoke_sprite),
+      health_histogram(health_histogram)
 {
     this->moveable_type = movableType::TANK;
+    if (health_histogram) health_histogram->add(health);
 }
 
 Tank::Tank() {
@@ -41,7 +44,14 @@ Tank::~Tank()
 {
 }
 
-void Tank::tick(Terrain& terrain)
+void Tank::tick(const Terrain& terrain)
+{
+    move();
+    tick_state(terrain.get_routes());
+}
+
+//Movement towards the target, tick_range does the same four tanks at a time
+void Tank::move()
 {
     vec2 direction = vec2(0, 0);
 
@@ -53,7 +63,83 @@ void Tank::tick(Terrain& terrain)
     //Update using accumulated force
     speed = direction + force;
     position += speed * max_speed * 0.5f;
+}
 
+// -----------------------------------------------------------
+// Tick a range of tanks, same result as calling tick on every active one
+// Tanks are stored as structures, so four of them at a time are transposed into
+// SSE registers that each hold one field (x, y, ...) of all four, the movement
+// is computed on those and the results are written back per tank
+// Groups with an inactive tank fall back to ticking one by one
+// -----------------------------------------------------------
+void Tank::tick_range(Tank* tanks, size_t count, const Terrain& terrain)
+{
+    const RoutePool& routes = terrain.get_routes();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        Tank* t = tanks + i;
+        if (!(t[0].active && t[1].active && t[2].active && t[3].active))
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (!t[lane].active) continue;
+                t[lane].move();
+                t[lane].tick_state(routes);
+            }
+            continue;
+        }
+
+        const __m128 position_x = _mm_setr_ps(t[0].position.x, t[1].position.x, t[2].position.x, t[3].position.x);
+        const __m128 position_y = _mm_setr_ps(t[0].position.y, t[1].position.y, t[2].position.y, t[3].position.y);
+        const __m128 target_x = _mm_setr_ps(t[0].target.x, t[1].target.x, t[2].target.x, t[3].target.x);
+        const __m128 target_y = _mm_setr_ps(t[0].target.y, t[1].target.y, t[2].target.y, t[3].target.y);
+        const __m128 force_x = _mm_setr_ps(t[0].force.x, t[1].force.x, t[2].force.x, t[3].force.x);
+        const __m128 force_y = _mm_setr_ps(t[0].force.y, t[1].force.y, t[2].force.y, t[3].force.y);
+        const __m128 max_speed = _mm_setr_ps(t[0].max_speed, t[1].max_speed, t[2].max_speed, t[3].max_speed);
+
+        //Normalized direction to the target, zero for tanks that are on their target
+        const __m128 moving = _mm_or_ps(_mm_cmpneq_ps(target_x, position_x), _mm_cmpneq_ps(target_y, position_y));
+        const __m128 delta_x = _mm_sub_ps(target_x, position_x);
+        const __m128 delta_y = _mm_sub_ps(target_y, position_y);
+        const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(delta_x, delta_x), _mm_mul_ps(delta_y, delta_y)));
+        const __m128 inverse_length = _mm_div_ps(one, length);
+        const __m128 direction_x = _mm_and_ps(moving, _mm_mul_ps(delta_x, inverse_length));
+        const __m128 direction_y = _mm_and_ps(moving, _mm_mul_ps(delta_y, inverse_length));
+
+        //Update using accumulated force
+        const __m128 speed_x = _mm_add_ps(direction_x, force_x);
+        const __m128 speed_y = _mm_add_ps(direction_y, force_y);
+        const __m128 new_x = _mm_add_ps(position_x, _mm_mul_ps(_mm_mul_ps(speed_x, max_speed), half));
+        const __m128 new_y = _mm_add_ps(position_y, _mm_mul_ps(_mm_mul_ps(speed_y, max_speed), half));
+
+        alignas(16) float results[4][4];
+        _mm_store_ps(results[0], speed_x);
+        _mm_store_ps(results[1], speed_y);
+        _mm_store_ps(results[2], new_x);
+        _mm_store_ps(results[3], new_y);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            t[lane].speed = vec2(results[0][lane], results[1][lane]);
+            t[lane].position = vec2(results[2][lane], results[3][lane]);
+            t[lane].tick_state(routes);
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        if (!tanks[i].active) continue;
+        tanks[i].move();
+        tanks[i].tick_state(routes);
+    }
+}
+
+//Everything of a tick after the movement: reload, animation and the next waypoint
+void Tank::tick_state(const RoutePool& routes)
+{
     //Update reload time
     if (--reload_time <= 0.0f)
     {
@@ -64,24 +150,23 @@ void Tank::tick(Terrain& terrain)
 
     if (++current_frame > 8) current_frame = 0;
 
-    //Target reached?
-    if (current_route.size() > 0)
+    //Target reached? The cursor moves on to the next waypoint, the route itself stays as it is
+    if (route_cursor < route_end)
     {
         if (std::abs(position.x - target.x) < 8.f && std::abs(position.y - target.y) < 8.f)
         {
-            target = current_route.at(0);
-            current_route.erase(current_route.begin());
+            target = routes[route_cursor++];
         }
     }
 }
 
-void Tank::set_route(const std::vector<vec2>& route)
+void Tank::set_route(const Route& route, const RoutePool& routes)
 {
-    if (route.size() > 0)
+    if (!route.empty())
     {
-        current_route = route;
-        target = current_route.at(0);
-        current_route.erase(current_route.begin());
+        target = routes[route.begin];
+        route_cursor = route.begin + 1;
+        route_end = route.end;
     }
     else
     {
@@ -89,6 +174,11 @@ void Tank::set_route(const std::vector<vec2>& route)
     }
 }
 
+bool Wreck::fits(Surface& target) const
+{
+    return left() >= 0 && top() >= 0 && left() + sprite->get_width() <= target.get_width() && top() + sprite->get_height() <= target.get_height();
+}
+
 //Start reloading timer
 void Tank::reload_rocket()
 {
@@ -98,12 +188,14 @@ void Tank::reload_rocket()
 
 void Tank::deactivate()
 {
+    if (active && health_histogram) health_histogram->remove(health);
     active = false;
 }
 
 //Remove health
 bool Tank::hit(int hit_value)
 {
+    if (active && health_histogram) health_histogram->move(health, health - hit_value);
     health -= hit_value;
 
     if (health <= 0)
@@ -116,11 +208,15 @@ bool Tank::hit(int hit_value)
 }
 
 //Draw the sprite with the facing based on this tanks movement direction
-void Tank::draw(Surface* screen)
+void Tank::draw(DrawList& draw_list)
+{
+    draw_list.draw_world_sprite(tank_sprite, get_sprite_frame(), position, -7, -9);
+}
+
+int Tank::get_sprite_frame() const
 {
     vec2 direction = (target - position).normalized();
-    tank_sprite->set_frame(((abs(direction.x) > abs(direction.y)) ? ((direction.x < 0) ? 3 : 0) : ((direction.y < 0) ? 9 : 6)) + (current_frame / 3));
-    tank_sprite->draw(screen, (int)position.x - 7 + HEALTHBAR_OFFSET, (int)position.y - 9);
+    return ((abs(direction.x) > abs(direction.y)) ? ((direction.x < 0) ? 3 : 0) : ((direction.y < 0) ? 9 : 6)) + (current_frame / 3);
 }
 
 int Tank::compare_health(const Tank& other) const
@@ -10,28 +10,52 @@ enum allignments
     RED
 };
 
+// -----------------------------------------------------------
+// What is left of a destroyed tank, it is only drawn
+// -----------------------------------------------------------
+struct Wreck
+{
+    vec2 position;
+    Sprite* sprite;
+    int frame;
+
+    void draw(DrawList& draw_list) const { draw_list.draw_world_sprite(sprite, frame, position, -7, -9); }
+
+    //Draw straight into a world space surface, only when the whole sprite fits on it
+    bool fits(Surface& target) const;
+    void draw(Surface& target) const { sprite->draw_frame(&target, left(), top(), frame); }
+
+  private:
+    int left() const { return (int)floorf(position.x) - 7; }
+    int top() const { return (int)floorf(position.y) - 9; }
+};
+
 class Tank : public movable
 {
   public:
-    Tank(float pos_x, float pos_y, allignments allignment, Sprite* tank_sprite, Sprite* smoke_sprite, float tar_x, float tar_y, float collision_radius, int health, float max_speed);
+    Tank(float pos_x, float pos_y, allignments allignment, Sprite* tank_sprite, Sprite* smoke_sprite, float tar_x, float tar_y, float collision_radius, int health, float max_speed, HealthHistogram* health_histogram = nullptr);
 
     Tank();
 
     ~Tank();
 
-    void tick(Terrain& terrain);
+    void tick(const Terrain& terrain);
+
+    //Ticks the active tanks of the range, four at a time
+    static void tick_range(Tank* tanks, size_t count, const Terrain& terrain);
 
     vec2 get_position() const { return position; };
     float get_collision_radius() const { return collision_radius; };
     bool rocket_reloaded() const { return reloaded; };
 
-    void set_route(const std::vector<vec2>& route);
+    void set_route(const Route& route, const RoutePool& routes);
     void reload_rocket();
 
     void deactivate();
     bool hit(int hit_value);
 
-    void draw(Surface* screen);
+    void draw(DrawList& draw_list);
+    Wreck to_wreck() const { return { position, tank_sprite, get_sprite_frame() }; }
 
     int compare_health(const Tank& other) const;
 
@@ -41,7 +65,10 @@ class Tank : public movable
     vec2 speed;
     vec2 target;
 
-    vector<vec2> current_route;
+    //Waypoints after the current target, indices into the terrain's route pool
+    uint32_t route_cursor = 0;
+    uint32_t route_end = 0;
+
 
     int health;
 
@@ -60,6 +87,13 @@ class Tank : public movable
     Sprite* tank_sprite;
     Sprite* smoke_sprite;
 
+    //Team health histogram, kept up to date when this tank is hit or deactivated
+    HealthHistogram* health_histogram = nullptr;
+
+  private:
+    int get_sprite_frame() const;
+    void move();
+    void tick_state(const RoutePool& routes);
 };
 
 } // namespace Tmpl8
\ No newline at end of file
@@ -219,8 +219,40 @@ void swap()
 int main(int argc, char** argv)
 {
     printf("application started.\n");
+
+    //"--counters" samples hardware performance counters per phase and prints them when a run ends
+    //"--allocations" tracks heap allocations per phase and thread, shown in the HUD and printed when a run ends
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--counters") == 0) PerfCounters::enable();
+        if (strcmp(argv[i], "--allocations") == 0) AllocationTracker::enable();
+    }
+
+    //"--benchmark [file]" runs the benchmark scenarios without opening a window, see benchmark.h
+    BenchmarkRunner benchmark;
+    if (benchmark.parse_arguments(argc, argv)) return benchmark.run();
+
+    //"--microbench [filter]" times the hot kernels in isolation, see microbench.h
+    Microbench microbench;
+    if (microbench.parse_arguments(argc, argv)) return microbench.run();
+
+    //"--selftest" checks the SIMD surface operations against their scalar versions, see selftest.h
+    SelfTest selftest;
+    if (selftest.parse_arguments(argc, argv)) return selftest.run();
+
     SDL_Init(SDL_INIT_VIDEO);
 
+    //"--pbo" presents through persistently mapped pixel buffers instead of copying into an SDL texture
+    //"--trace <file>" records a timeline of all threads and writes it as Chrome trace JSON on exit
+    bool use_pbo = false;
+    const char* trace_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--pbo") == 0) use_pbo = true;
+        if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc)) trace_path = argv[++i];
+    }
+    if (trace_path) Trace::enable();
+
 #ifdef ADVANCEDGL
 #ifdef FULLSCREEN
     window = SDL_CreateWindow(TEMPLATE_VERSION, 100, 100, SCRWIDTH, SCRHEIGHT, SDL_WINDOW_FULLSCREEN | SDL_WINDOW_OPENGL);
@@ -231,19 +263,32 @@ int main(int argc, char** argv)
     init();
     ShowCursor(false);
 #else
+    const Uint32 gl_flag = use_pbo ? SDL_WINDOW_OPENGL : 0;
 #ifdef FULLSCREEN
-    window = SDL_CreateWindow(TEMPLATE_VERSION, 100, 100, SCRWIDTH, SCRHEIGHT, SDL_WINDOW_FULLSCREEN);
+    window = SDL_CreateWindow(TEMPLATE_VERSION, 100, 100, SCRWIDTH, SCRHEIGHT, SDL_WINDOW_FULLSCREEN | gl_flag);
 #else
-    window = SDL_CreateWindow(TEMPLATE_VERSION, 100, 100, SCRWIDTH, SCRHEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow(TEMPLATE_VERSION, 100, 100, SCRWIDTH, SCRHEIGHT, SDL_WINDOW_SHOWN | gl_flag);
 #endif
-    surface = new Surface(SCRWIDTH, SCRHEIGHT);
+    PBOPresenter pbo_presenter;
+    if (use_pbo && !pbo_presenter.init(window, SCRWIDTH, SCRHEIGHT))
+    {
+        std::cout << "Falling back to copying into an SDL streaming texture." << std::endl;
+        use_pbo = false;
+    }
+    SDL_Renderer* renderer = 0;
+    SDL_Texture* frameBuffer = 0;
+    //With PBOs the game renders straight into the mapped buffers, so there is no copy per frame
+    surface = use_pbo ? new Surface(SCRWIDTH, SCRHEIGHT, pbo_presenter.next_buffer(), SCRWIDTH) : new Surface(SCRWIDTH, SCRHEIGHT);
     surface->clear(0);
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED /* | SDL_RENDERER_PRESENTVSYNC*/);
-    SDL_Texture* frameBuffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCRWIDTH, SCRHEIGHT);
+    if (!use_pbo)
+    {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED /* | SDL_RENDERER_PRESENTVSYNC*/);
+        frameBuffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCRWIDTH, SCRHEIGHT);
+    }
 #endif
     int exitapp = 0;
     game = new Game();
-    game->set_target(surface);
+    game->set_target(surface, use_pbo);
     timer t;
     t.reset();
     while (!exitapp)
@@ -252,25 +297,33 @@ int main(int argc, char** argv)
         swap();
         surface->SetBuffer((Pixel*)framedata);
 #else
-        void* target = 0;
-        int pitch;
-        SDL_LockTexture(frameBuffer, NULL, &target, &pitch);
-        if (pitch == (surface->get_width() * 4))
+        if (use_pbo)
         {
-            memcpy(target, surface->get_buffer(), SCRWIDTH * SCRHEIGHT * 4);
+            pbo_presenter.present();
+            surface->set_buffer(pbo_presenter.next_buffer());
         }
         else
         {
-            unsigned char* t = (unsigned char*)target;
-            for (int i = 0; i < SCRHEIGHT; i++)
+            void* target = 0;
+            int pitch;
+            SDL_LockTexture(frameBuffer, NULL, &target, &pitch);
+            if (pitch == (surface->get_width() * 4))
             {
-                memcpy(t, surface->get_buffer() + i * SCRWIDTH, SCRWIDTH * 4);
-                t += pitch;
+                memcpy(target, surface->get_buffer(), SCRWIDTH * SCRHEIGHT * 4);
             }
+            else
+            {
+                unsigned char* t = (unsigned char*)target;
+                for (int i = 0; i < SCRHEIGHT; i++)
+                {
+                    memcpy(t, surface->get_buffer() + i * SCRWIDTH, SCRWIDTH * 4);
+                    t += pitch;
+                }
+            }
+            SDL_UnlockTexture(frameBuffer);
+            SDL_RenderCopy(renderer, frameBuffer, NULL, NULL);
+            SDL_RenderPresent(renderer);
         }
-        SDL_UnlockTexture(frameBuffer);
-        SDL_RenderCopy(renderer, frameBuffer, NULL, NULL);
-        SDL_RenderPresent(renderer);
 #endif
         if (firstframe)
         {
@@ -316,6 +369,10 @@ int main(int argc, char** argv)
         }
     }
     game->shutdown();
+    if (trace_path) Trace::write(trace_path);
+#ifndef ADVANCEDGL
+    pbo_presenter.shutdown();
+#endif
     SDL_Quit();
     return 1;
 }
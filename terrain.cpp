@@ -4,7 +4,7 @@
 namespace fs = std::filesystem;
 namespace Tmpl8
 {
-    Terrain::Terrain()
+    Terrain::Terrain(const std::string& layout_file)
     {
         //Load in terrain sprites
         grass_img = std::make_unique<Surface>("assets/tile_grass.png");
@@ -22,7 +22,7 @@ namespace Tmpl8
 
 
         //Load terrain layout file and fill grid based on tiletypes
-        fs::path terrain_file_path{ "assets/terrain.txt" };
+        fs::path terrain_file_path{ layout_file };
         std::ifstream terrain_file(terrain_file_path);
 
         if (terrain_file.is_open())
@@ -100,7 +100,7 @@ namespace Tmpl8
         {
             for (size_t x = 0; x < tiles.at(y).size(); x++)
             {
-                int posX = (x * sprite_size) + HEALTHBAR_OFFSET;
+                int posX = x * sprite_size;
                 int posY = y * sprite_size;
 
                 switch (tiles.at(y).at(x).tile_type)
@@ -128,25 +128,56 @@ namespace Tmpl8
         }
     }
 
+    //Route to the destination, searched only when no route from this tile to the destination is known yet
+    Route Terrain::get_route(const Tank& tank, const vec2& target)
+    {
+        const uint64_t key = route_key(tile_index(tank.position), tile_index(target));
+        if (const Route* known = routes.find(key))
+        {
+            return *known;
+        }
+
+        if (!find_route(tank.position, target, route_scratch))
+        {
+            routes.add_empty(key);
+            return Route();
+        }
+
+        //Every waypoint of the route is the start of the route from that tile on
+        route_keys_scratch.clear();
+        for (const vec2& waypoint : route_scratch)
+        {
+            route_keys_scratch.push_back(route_key(tile_index(waypoint), tile_index(target)));
+        }
+        return routes.add(route_scratch.data(), route_keys_scratch.data(), route_scratch.size());
+    }
+
     //Use Breadth-first search to find shortest route to the destination
-    vector<vec2> Terrain::get_route(const Tank& tank, const vec2& target)
+    bool Terrain::find_route(const vec2& start, const vec2& target, vector<vec2>& route)
     {
+        route.clear();
+
         //Find start and target tile
-        const size_t pos_x = tank.position.x / sprite_size;
-        const size_t pos_y = tank.position.y / sprite_size;
+        const size_t pos_x = start.x / sprite_size;
+        const size_t pos_y = start.y / sprite_size;
 
         const size_t target_x = target.x / sprite_size;
         const size_t target_y = target.y / sprite_size;
 
+        //The partial routes are temporaries, they go into the frame arena and are handed back on return
+        FrameArena::Scope scope;
+        FrameArena& arena = FrameArena::get();
+
         //Init queue with start tile
-        std::queue<vector<TerrainTile*>> queue;
+        using RouteQueue = std::pmr::deque<frame_vector<TerrainTile*>>;
+        std::queue<frame_vector<TerrainTile*>, RouteQueue> queue{ RouteQueue(&arena) };
         queue.emplace();
         queue.back().push_back(&tiles.at(pos_y).at(pos_x));
 
-        std::vector<TerrainTile*> visited;
+        frame_vector<TerrainTile*> visited(&arena);
 
         bool route_found = false;
-        vector<TerrainTile*> current_route;
+        frame_vector<TerrainTile*> current_route(&arena);
         while (!queue.empty() && !route_found)
         {
             current_route = queue.front();
@@ -181,19 +212,13 @@ namespace Tmpl8
         if (route_found)
         {
             //Convert route to vec2 to prevent dangling pointers
-            std::vector<vec2> route;
+            route.reserve(current_route.size());
             for (TerrainTile* tile : current_route)
             {
                 route.push_back(vec2((float)tile->position_x * sprite_size, (float)tile->position_y * sprite_size));
             }
-
-            return route;
         }
-        else
-        {
-            return  std::vector<vec2>();
-        }
-
+        return route_found;
     }
 
     //TODO: Function not used, convert BFS to dijkstra and take speed into account next year :)
@@ -30,13 +30,25 @@ namespace Tmpl8
     {
     public:
 
-        Terrain();
+        Terrain(const std::string& layout_file = "assets/terrain.txt");
 
         void update();
+        //Draws the terrain in world space, the target should be at least get_world_size() large
         void draw(Surface* target) const;
 
-        //Use Breadth-first search to find shortest route to the destination
-        vector<vec2> get_route(const Tank& tank, const vec2& target);
+        //Size of the terrain in pixels
+        vec2 get_world_size() const { return vec2((float)(terrain_width * sprite_size), (float)(terrain_height * sprite_size)); }
+
+        //Shortest route from the tank to the destination, stored in get_routes()
+        //Routes are shared: every start and destination tile is only searched once
+        //Not thread safe, the search marks tiles as visited
+        Route get_route(const Tank& tank, const vec2& target);
+
+        //Use Breadth-first search to find shortest route to the destination, false when there is none
+        //Always searches, route is filled with the top left corners of the tiles on the way
+        bool find_route(const vec2& start, const vec2& target, vector<vec2>& route);
+
+        const RoutePool& get_routes() const { return routes; }
 
         float get_speed_modifier(const vec2& position) const;
 
@@ -45,6 +57,9 @@ namespace Tmpl8
 
         bool is_accessible(int y, int x);
 
+        static size_t tile_index(const vec2& position) { return (size_t)(position.y / sprite_size) * terrain_width + (size_t)(position.x / sprite_size); }
+        static uint64_t route_key(size_t start_tile, size_t target_tile) { return (uint64_t)start_tile * (terrain_width * terrain_height) + target_tile; }
+
         static constexpr int sprite_size = 16;
         static constexpr size_t terrain_width = 80;
         static constexpr size_t terrain_height = 45;
@@ -62,5 +77,9 @@ namespace Tmpl8
         std::unique_ptr<Sprite> tile_water;
 
         std::array<std::array<TerrainTile, terrain_width>, terrain_height> tiles;
+
+        RoutePool routes;
+        vector<vec2> route_scratch;
+        vector<uint64_t> route_keys_scratch;
     };
 }
\ No newline at end of file
@@ -11,12 +11,13 @@ class Worker
 {
   public:
     //Instantiate the worker class by passing and storing the threadpool as a reference
-    Worker(ThreadPool& s) : pool(s) {}
+    Worker(ThreadPool& s, int index) : pool(s), index(index) {}
 
     inline void operator()();
 
   private:
     ThreadPool& pool;
+    int index;
 };
 
 class ThreadPool
@@ -25,7 +26,7 @@ class ThreadPool
     ThreadPool(size_t numThreads) : stop(false)
     {
         for (size_t i = 0; i < numThreads; ++i)
-            workers.push_back(std::thread(Worker(*this)));
+            workers.push_back(std::thread(Worker(*this, total_workers++)));
     }
 
     ~ThreadPool()
@@ -37,43 +38,126 @@ class ThreadPool
             thread.join();
     }
 
+    //The name shows up in traces, it must be a string literal
+    //The task and the state shared with its future live in the calling thread's frame arena,
+    //so enqueueing doesn't touch the heap, wait for the future (and wait_idle) before the arena is reset
     template <class T>
-    auto enqueue(T task) -> std::future<decltype(task())>
+    auto enqueue(T task, const char* name = "task") -> std::future<decltype(task())>
     {
-        //Wrap the function in a packaged_task so we can return a future object
-        auto wrapper = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        using Result = decltype(task());
+
+        std::pmr::polymorphic_allocator<std::byte> allocator(&FrameArena::get());
+        Job<T, Result>* job = static_cast<Job<T, Result>*>(allocator.resource()->allocate(sizeof(Job<T, Result>), alignof(Job<T, Result>)));
+        new (job) Job<T, Result>(std::move(task), allocator);
+        std::future<Result> future = job->promise.get_future();
 
         //Scope to restrict critical section
         {
             //lock our queue and add the given task to it
             std::unique_lock<std::mutex> lock(queue_mutex);
 
-            tasks.push_back([=] {
-                (*wrapper)();
-            });
+            tasks.push_back({ [job] { job->run(); }, name, AllocationTracker::get_section() });
         }
 
         //Wake up a thread to start this task
         condition.notify_one();
 
-        return wrapper->get_future();
+        return future;
+    }
+
+    //Returns once the queue is empty and no worker is running a task anymore,
+    //a task's future is ready a moment before the worker is done with the task
+    void wait_idle()
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                if (next_task == tasks.size() && busy_workers.load() == 0) return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    //Workers push the duration of every task they run to the ring, nullptr disables this
+    //Returns once no worker can push into the previous ring anymore, so it can be destroyed
+    void set_metrics(MetricsRing* ring)
+    {
+        metrics = ring;
+        while (metrics_users.load() != 0) std::this_thread::yield();
     }
 
+    size_t get_worker_count() const { return workers.size(); }
+
+    //Worker indices are unique over all pools, -1 on threads that are not pool workers
+    static int get_current_worker() { return current_worker; }
+    static int get_total_workers() { return total_workers; }
+
   private:
     friend class Worker; //Gives access to the private variables of this class
 
+    //A task with the promise its future waits on
+    template <class T, class Result>
+    struct Job
+    {
+        Job(T&& task, const std::pmr::polymorphic_allocator<std::byte>& allocator) : task(std::move(task)), promise(std::allocator_arg, allocator) {}
+
+        //Destroys the job, its memory is handed back by the arena reset
+        void run()
+        {
+            try
+            {
+                if constexpr (std::is_void_v<Result>)
+                {
+                    task();
+                    promise.set_value();
+                }
+                else
+                {
+                    promise.set_value(task());
+                }
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+            this->~Job();
+        }
+
+        T task;
+        std::promise<Result> promise;
+    };
+
     std::vector<std::thread> workers;
-    std::deque<std::function<void()>> tasks;
+    struct Task
+    {
+        std::function<void()> function; //Only captures the job pointer, so it fits in the function without allocating
+        const char* name;
+        int allocation_section; //The enqueuing thread's, see AllocationTracker
+    };
+    //Queue that keeps its memory: tasks are taken from next_task on, and both are cleared once it runs empty
+    std::vector<Task> tasks;
+    size_t next_task = 0;
+    std::atomic<int> busy_workers = 0; //Workers that took a task and didn't finish it yet, only incremented under queue_mutex
 
     std::condition_variable condition; //Wakes up a thread when work is available
 
     std::mutex queue_mutex; //Lock for our queue
     bool stop = false;
+
+    std::atomic<MetricsRing*> metrics = nullptr;
+    std::atomic<int> metrics_users = 0; //Workers between loading the ring and pushing to it
+
+    static inline std::atomic<int> total_workers = 0;
+    static inline thread_local int current_worker = -1;
 };
 
 inline void Worker::operator()()
 {
-    std::function<void()> task;
+    ThreadPool::current_worker = index;
+    Trace::set_thread_name("worker " + std::to_string(index));
+
+    ThreadPool::Task task;
     while (true)
     {
         //Scope to restrict critical section
@@ -84,15 +168,44 @@ inline void Worker::operator()()
 
             //Wait until some work is ready or we are stopping the threadpool
             //Because of spurious wakeups we need to check if there is actually a task available or we are stopping
-            pool.condition.wait(locker, [=] { return pool.stop || !pool.tasks.empty(); });
+            pool.condition.wait(locker, [=] { return pool.stop || pool.next_task < pool.tasks.size(); });
 
             if (pool.stop) break;
 
-            task = pool.tasks.front();
-            pool.tasks.pop_front();
+            task = std::move(pool.tasks[pool.next_task++]);
+            if (pool.next_task == pool.tasks.size())
+            {
+                pool.tasks.clear();
+                pool.next_task = 0;
+            }
+            pool.busy_workers++;
+        }
+
+        AllocationTracker::set_section(task.allocation_section);
+
+        //The task's future is ready before the sample is pushed, so a consumer waiting on the
+        //future may only see the sample a little later (the HUD counts it in the next frame)
+        pool.metrics_users.fetch_add(1);
+        MetricsRing* metrics = pool.metrics.load();
+        const bool traced = Trace::is_enabled();
+        if (!metrics && !traced)
+        {
+            pool.metrics_users.fetch_sub(1);
+            task.function();
+        }
+        else
+        {
+            const timer::TimePoint begin = timer::get();
+            task.function();
+            const timer::TimePoint end = timer::get();
+
+            if (metrics) metrics->push({ MetricType::TASK, (uint16_t)index, std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.f });
+            pool.metrics_users.fetch_sub(1);
+            if (traced) Trace::record(task.name, "task", begin, end);
         }
 
-        task();
+        AllocationTracker::set_section(AllocationTracker::no_section);
+        pool.busy_workers.fetch_sub(1);
     }
 }
 
@@ -0,0 +1,217 @@
+#include "precomp.h"
+#include "tile_renderer.h"
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Rasterise the recorded frame
+// The commands are binned into tiles in a single pass, then every task owns one row
+// of tiles and draws them one by one, so each tile stays in cache while it is being drawn.
+// Tiles never overlap, so no locking is needed while writing to the target.
+// -----------------------------------------------------------
+void TileRenderer::render(const DrawList& list, Surface* target, Surface* background, ThreadPool& pool, bool write_only)
+{
+    this->commands = &list.get_commands();
+    this->camera = &list.get_camera();
+    this->target = target;
+    this->write_only = write_only;
+    this->background = background;
+
+    bin_commands();
+
+    for (int tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+        tasks.push_back(pool.enqueue([this, tile_y]() {
+            render_tile_row(tile_y);
+        }, "tile row"));
+    }
+
+    TraceScope trace("wait for tiles", "wait");
+    for (future<void>& task : tasks)
+    {
+        task.wait();
+    }
+    tasks.clear();
+}
+
+// -----------------------------------------------------------
+// Sort the command indices by tile, bin t holds bin_indices[bin_start[t]] up to
+// bin_indices[bin_start[t + 1]], tiles are numbered row by row.
+// Counts first, so all bins fit in one list of exactly the right size,
+// then fills in recording order, so every bin is in painter's order.
+// -----------------------------------------------------------
+void TileRenderer::bin_commands()
+{
+    //Tiles a command touches, false when it is off screen
+    const auto get_tiles = [](const DrawCommand& command, int& tile_x1, int& tile_y1, int& tile_x2, int& tile_y2) {
+        const int x1 = (int)floorf(std::min(command.x1, command.x2)), x2 = (int)ceilf(std::max(command.x1, command.x2));
+        const int y1 = (int)floorf(std::min(command.y1, command.y2)), y2 = (int)ceilf(std::max(command.y1, command.y2));
+        if (x2 < 0 || y2 < 0 || x1 >= SCRWIDTH || y1 >= SCRHEIGHT) return false;
+
+        tile_x1 = std::max(x1, 0) / tile_size, tile_x2 = std::min(x2, SCRWIDTH - 1) / tile_size;
+        tile_y1 = std::max(y1, 0) / tile_size, tile_y2 = std::min(y2, SCRHEIGHT - 1) / tile_size;
+        return true;
+    };
+
+    std::fill(bin_start.begin(), bin_start.end(), 0);
+    int tile_x1, tile_y1, tile_x2, tile_y2;
+    for (const DrawCommand& command : *commands)
+    {
+        if (!get_tiles(command, tile_x1, tile_y1, tile_x2, tile_y2)) continue;
+        for (int tile_y = tile_y1; tile_y <= tile_y2; tile_y++)
+        {
+            for (int tile_x = tile_x1; tile_x <= tile_x2; tile_x++) bin_start[tile_y * tiles_x + tile_x + 1]++;
+        }
+    }
+    for (int tile = 0; tile < tiles_x * tiles_y; tile++) bin_start[tile + 1] += bin_start[tile];
+
+    bin_indices.resize(bin_start[tiles_x * tiles_y]);
+    std::copy(bin_start.begin(), bin_start.end() - 1, bin_end.begin());
+    for (uint32_t i = 0; i < commands->size(); i++)
+    {
+        if (!get_tiles((*commands)[i], tile_x1, tile_y1, tile_x2, tile_y2)) continue;
+        for (int tile_y = tile_y1; tile_y <= tile_y2; tile_y++)
+        {
+            for (int tile_x = tile_x1; tile_x <= tile_x2; tile_x++) bin_indices[bin_end[tile_y * tiles_x + tile_x]++] = i;
+        }
+    }
+}
+
+void TileRenderer::render_tile_row(int tile_y)
+{
+    for (int tile_x = 0; tile_x < tiles_x; tile_x++)
+    {
+        const int tile = tile_y * tiles_x + tile_x;
+        render_tile(tile_x, tile_y, bin_indices.data() + bin_start[tile], bin_indices.data() + bin_start[tile + 1]);
+    }
+    //The tiles were streamed out, make them visible before the task reports that it is done
+    if (write_only) surface_ops::stream_fence();
+}
+
+void TileRenderer::render_tile(int tile_x, int tile_y, const uint32_t* bin_begin, const uint32_t* bin_end)
+{
+    const int x0 = tile_x * tile_size;
+    const int y0 = tile_y * tile_size;
+    const int width = std::min(tile_size, target->get_width() - x0);
+    const int height = std::min(tile_size, target->get_height() - y0);
+
+    //Blending reads what is below, so a write-only target is drawn in a tile buffer and only gets the result,
+    //other targets are drawn in place through a view on the part this tile covers
+    alignas(64) Pixel buffer[tile_size * tile_size];
+    Pixel* pixels = write_only ? buffer : target->get_buffer() + x0 + y0 * target->get_pitch();
+    const int pitch = write_only ? tile_size : target->get_pitch();
+    Surface tile(width, height, pixels, pitch);
+
+    for (int y = 0; y < height; y++)
+    {
+        copy_background_row(pixels + y * pitch, x0, y0 + y, width);
+    }
+
+    for (const uint32_t* index = bin_begin; index != bin_end; index++)
+    {
+        const DrawCommand& command = (*commands)[*index];
+        switch (command.type)
+        {
+        case DrawCommandType::SPRITE:
+        {
+            Sprite* sprite = Sprite::from_id(command.sprite);
+            const int sprite_width = (int)command.x2 - (int)command.x1 + 1, sprite_height = (int)command.y2 - (int)command.y1 + 1;
+            if (sprite_width == sprite->get_width() && sprite_height == sprite->get_height())
+            {
+                sprite->draw_frame(&tile, (int)command.x1 - x0, (int)command.y1 - y0, command.frame, command.flags);
+            }
+            else
+            {
+                //Zoomed, the scaled blit starts stepping at the clipped edge so every tile samples the same texels
+                sprite->draw_scaled_frame((int)command.x1 - x0, (int)command.y1 - y0, sprite_width, sprite_height, &tile, command.frame, false, command.flags);
+            }
+            break;
+        }
+        case DrawCommandType::BAR:
+        {
+            const int x1 = std::max((int)command.x1, x0), x2 = std::min((int)command.x2, x0 + width - 1);
+            const int y1 = std::max((int)command.y1, y0), y2 = std::min((int)command.y2, y0 + height - 1);
+            if (x1 <= x2 && y1 <= y2) tile.bar(x1 - x0, y1 - y0, x2 - x0, y2 - y0, command.color);
+            break;
+        }
+        case DrawCommandType::LINE:
+            //Lines are stepped over the whole target and clipped to the tile, so they match a single threaded draw exactly
+            tile.line(command.x1, command.y1, command.x2, command.y2, command.color, target->get_width(), target->get_height(), x0, y0);
+            break;
+        case DrawCommandType::SHADE:
+        {
+            const int x1 = std::max((int)command.x1, x0), x2 = std::min((int)command.x2, x0 + width - 1);
+            const int y1 = std::max((int)command.y1, y0), y2 = std::min((int)command.y2, y0 + height - 1);
+            for (int y = y1; y <= y2 && x1 <= x2; y++)
+            {
+                surface_ops::scale_color(pixels + (x1 - x0) + (y - y0) * pitch, x2 - x1 + 1, command.frame);
+            }
+            break;
+        }
+        case DrawCommandType::GLYPH:
+            Font::from_id(command.sprite)->draw_glyph(&tile, (int)command.frame, (int)command.x1, (int)command.y1, x0, y0);
+            break;
+        }
+    }
+
+    if (!write_only) return;
+
+    //Only written, row by row in address order, the target may be write-combined memory
+    const int target_pitch = target->get_pitch();
+    Pixel* dst = target->get_buffer() + x0 + y0 * target_pitch;
+    for (int y = 0; y < height; y++, dst += target_pitch)
+    {
+        surface_ops::copy_stream(dst, buffer + y * tile_size, width);
+    }
+}
+
+// Copy one row of the background, as seen through the camera, into the target
+// Pixels outside the viewport or outside the world are black
+void TileRenderer::copy_background_row(Pixel* dst, int x, int y, int width) const
+{
+    const int viewport_x1 = camera->get_viewport_x(), viewport_x2 = viewport_x1 + camera->get_viewport_width();
+    const int viewport_y1 = camera->get_viewport_y(), viewport_y2 = viewport_y1 + camera->get_viewport_height();
+    const float zoom = camera->get_zoom();
+
+    const int v = (int)floorf(camera->get_position().y + ((float)(y - viewport_y1) + 0.5f) / zoom);
+    if (!background || y < viewport_y1 || y >= viewport_y2 || v < 0 || v >= background->get_height())
+    {
+        memset(dst, 0, width * sizeof(Pixel));
+        return;
+    }
+
+    const Pixel* src = background->get_buffer() + v * background->get_pitch();
+    const int background_width = background->get_width();
+
+    //16.16 fixed point position in the background row, sampled at the pixel centers
+    //Stepped from the left edge of the viewport, so neighbouring tiles line up exactly
+    const int64_t du = (int64_t)(65536.f / zoom);
+    int64_t u = (int64_t)floor((camera->get_position().x + 0.5f / zoom) * 65536.0) + du * (x - viewport_x1);
+
+    if (du == 65536)
+    {
+        //Not zoomed, the visible part is a single span
+        const int shift = (int)(u >> 16) - x;
+        const int start = std::max(x, std::max(viewport_x1, -shift));
+        const int end = std::min(x + width, std::min(viewport_x2, background_width - shift));
+        if (start >= end)
+        {
+            memset(dst, 0, width * sizeof(Pixel));
+            return;
+        }
+        memset(dst, 0, (start - x) * sizeof(Pixel));
+        memcpy(dst + (start - x), src + start + shift, (end - start) * sizeof(Pixel));
+        memset(dst + (end - x), 0, (x + width - end) * sizeof(Pixel));
+        return;
+    }
+
+    for (int i = 0; i < width; i++, u += du)
+    {
+        const int px = x + i;
+        const int su = (int)(u >> 16);
+        dst[i] = (px >= viewport_x1 && px < viewport_x2 && su >= 0 && su < background_width) ? src[su] : 0;
+    }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,46 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Bins the commands of a draw list into screen tiles and
+// rasterises the tiles in parallel on the thread pool.
+// Draw calls keep the order in which they were recorded (painter's order) within every tile.
+// A write-only target (see PBOPresenter) is never read: every tile is drawn in a small
+// buffer of its own and streamed to the target once it is finished. Other targets are
+// drawn in place, which saves copying every tile.
+// -----------------------------------------------------------
+class TileRenderer
+{
+  public:
+    static constexpr int tile_size = 32;
+    static constexpr int tiles_x = (SCRWIDTH + tile_size - 1) / tile_size;
+    static constexpr int tiles_y = (SCRHEIGHT + tile_size - 1) / tile_size;
+
+    //Draw the list to the target, every tile starts out as a copy of the world space background
+    //as seen through the list's camera, every pixel of the target is overwritten
+    //Returns once the whole frame is drawn
+    void render(const DrawList& list, Surface* target, Surface* background, ThreadPool& pool, bool write_only = false);
+
+  private:
+    void bin_commands();
+    void render_tile_row(int tile_y);
+    void render_tile(int tile_x, int tile_y, const uint32_t* bin_begin, const uint32_t* bin_end);
+    void copy_background_row(Pixel* dst, int x, int y, int width) const;
+
+    const vector<DrawCommand>* commands = nullptr;
+    const Camera* camera = nullptr;
+    Surface* target = nullptr;
+    bool write_only = false;
+    Surface* background = nullptr;
+
+    //Command indices sorted by tile, rebuilt every frame, see bin_commands
+    std::array<uint32_t, tiles_x * tiles_y + 1> bin_start = {};
+    std::array<uint32_t, tiles_x * tiles_y> bin_end = {};
+    vector<uint32_t> bin_indices;
+
+    vector<future<void>> tasks;
+};
+
+} // namespace Tmpl8
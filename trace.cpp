@@ -0,0 +1,73 @@
+#include "precomp.h"
+#include "trace.h"
+
+namespace Tmpl8
+{
+
+Trace::ThreadBuffer& Trace::local_buffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->id = (int)buffers.size();
+    }
+    return *buffer;
+}
+
+void Trace::set_thread_name(const std::string& name)
+{
+    local_buffer().name = name;
+}
+
+void Trace::record(const char* name, const char* category, TimePoint begin, TimePoint end)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    vector<Event>& events = local_buffer().events;
+    if (events.size() >= max_events_per_thread) return;
+
+    events.push_back({ name, category, duration_cast<nanoseconds>(begin - start).count(), duration_cast<nanoseconds>(end - begin).count() });
+}
+
+bool Trace::write(const char* path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write trace to " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+
+    char line[256];
+    bool first = true;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        if (!buffer->name.empty())
+        {
+            snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->id, buffer->name.c_str());
+            file << line;
+            first = false;
+        }
+
+        //Timestamps are in microseconds
+        for (const Event& event : buffer->events)
+        {
+            snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}", first ? "" : ",\n", event.name, event.category, event.begin / 1000.0, event.duration / 1000.0, buffer->id);
+            file << line;
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+
+    std::cout << "Trace written to " << path << std::endl;
+    return true;
+}
+
+} // namespace Tmpl8
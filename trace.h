@@ -0,0 +1,76 @@
+#pragma once
+
+namespace Tmpl8
+{
+
+// -----------------------------------------------------------
+// Optional timeline tracing, exported as Chrome trace-event JSON
+// (open the file in chrome://tracing or ui.perfetto.dev).
+// Every thread records complete events (begin and duration) into its own
+// buffer, so recording never takes a lock. When tracing is disabled the
+// only cost is checking a flag.
+// -----------------------------------------------------------
+class Trace
+{
+  public:
+    using TimePoint = timer::TimePoint;
+
+    static void enable() { enabled.store(true, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    //Name shown for the calling thread
+    static void set_thread_name(const std::string& name);
+
+    //Names and categories must be string literals (they are stored as pointers)
+    static void record(const char* name, const char* category, TimePoint begin, TimePoint end);
+
+    //Write all recorded events, only call while no traced work is running
+    static bool write(const char* path);
+
+  private:
+    //Recording stops for a thread once its buffer is full, so a long run can't eat all memory
+    static constexpr size_t max_events_per_thread = 1 << 18;
+
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        int64_t begin; //Nanoseconds since the start of the trace
+        int64_t duration;
+    };
+
+    struct ThreadBuffer
+    {
+        int id;
+        std::string name;
+        vector<Event> events;
+    };
+
+    static ThreadBuffer& local_buffer();
+
+    static inline std::atomic<bool> enabled = false;
+    static inline const TimePoint start = timer::get();
+
+    static inline std::mutex buffers_mutex; //Only taken when a thread records its first event
+    static inline vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+// -----------------------------------------------------------
+// Records the enclosing scope as a trace event
+// -----------------------------------------------------------
+class TraceScope
+{
+  public:
+    TraceScope(const char* name, const char* category) : name(name), category(category), begin(Trace::is_enabled() ? timer::get() : Trace::TimePoint()) {}
+    ~TraceScope()
+    {
+        if (Trace::is_enabled()) Trace::record(name, category, begin, timer::get());
+    }
+
+  private:
+    const char* name;
+    const char* category;
+    Trace::TimePoint begin;
+};
+
+} // namespace Tmpl8
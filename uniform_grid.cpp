@@ -1,57 +1,63 @@
 #include "precomp.h"
 #include "uniform_grid.h"
 
-vector<movable*> Tmpl8::uniform_grid::get_neighboring_objects(vec2 position)
+namespace Tmpl8
 {
-	vec2 center_tile = get_tile_indices(position);
-	vector<movable*> neighboring_objects;
-	for (int i = -1; i < 2; i++)
-	{
-		if (center_tile.x + i >= 0) {
-			for (int j = -1; j < 2; j++)
-			{
-				if (center_tile.y + j >= 0) {
-					mlock->lock();
-					neighboring_objects.insert(neighboring_objects.end(),
-						grid[center_tile.x + i][center_tile.y + j].begin(),
-						grid[center_tile.x + i][center_tile.y + j].end());
-					mlock->unlock();
-				}
-			}
-		}
-	}
-	return neighboring_objects;
-}
 
-void Tmpl8::uniform_grid::add_to_grid(movable* movable_object, vec2 position)
+uniform_grid::uniform_grid(vec2 world_size, float cell_size) : columns(std::max(1, (int)ceilf(world_size.x / cell_size))),
+                                                               rows(std::max(1, (int)ceilf(world_size.y / cell_size))),
+                                                               cell_size(cell_size),
+                                                               inverse_cell_size(1.f / cell_size),
+                                                               cell_start(columns * rows + 1, 0)
 {
-	vec2 tile = get_tile_indices(position);
-	mlock->lock();
-	grid[tile.x][tile.y].push_back(movable_object);
-	mlock->unlock();
 }
 
-void Tmpl8::uniform_grid::update_grid(movable* movable_object, vec2 old_position, vec2 new_position)
+void uniform_grid::clear()
 {
-	vec2 old_tile = get_tile_indices(old_position);
-	vec2 new_tile = get_tile_indices(new_position);
-	if (old_tile.x != new_tile.x || old_tile.y != new_tile.y)
-	{
-		mlock->lock();
-		grid[old_tile.x][old_tile.y].remove(movable_object);
-		grid[new_tile.x][new_tile.y].push_back(movable_object);
-		mlock->unlock();
-	}
+    pending.clear();
+    entries.clear();
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+    occupied_x1 = 0, occupied_y1 = 0, occupied_x2 = -1, occupied_y2 = -1;
 }
 
-vec2 Tmpl8::uniform_grid::get_tile_indices(vec2 position)
+// -----------------------------------------------------------
+// Counting sort of the pending entries by cell
+// -----------------------------------------------------------
+void uniform_grid::finish()
 {
-	// Calculate which indexes it is based on the position.
-	// To do this we check for each positon what the smallest number of devidends it is.
-	// Tile 
-	// X: 566.6 Y: 30.89
-	// Position / 16 -> round down.
-	int index_x = std::floor(position.x / 16);
-	int index_y = std::floor(position.y / 16);
-	return vec2(index_x, index_y);
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+
+    occupied_x1 = columns, occupied_y1 = rows, occupied_x2 = -1, occupied_y2 = -1;
+
+    //Count per cell, shifted by one so the prefix sum gives every cell's start
+    for (const Entry& entry : pending)
+    {
+        const int x = cell_x(entry.position.x), y = cell_y(entry.position.y);
+        cell_start[y * columns + x + 1]++;
+
+        occupied_x1 = std::min(occupied_x1, x), occupied_x2 = std::max(occupied_x2, x);
+        occupied_y1 = std::min(occupied_y1, y), occupied_y2 = std::max(occupied_y2, y);
+    }
+    for (size_t cell = 1; cell < cell_start.size(); cell++)
+    {
+        cell_start[cell] += cell_start[cell - 1];
+    }
+
+    //Scatter, every cell's start moves along as the cell fills up
+    entries.resize(pending.size());
+    for (const Entry& entry : pending)
+    {
+        entries[cell_start[cell_y(entry.position.y) * columns + cell_x(entry.position.x)]++] = entry;
+    }
+
+    //Every cell's insert position ended at the start of the next cell, shift them back
+    for (size_t cell = cell_start.size() - 1; cell > 0; cell--)
+    {
+        cell_start[cell] = cell_start[cell - 1];
+    }
+    cell_start[0] = 0;
+
+    pending.clear();
 }
+
+} // namespace Tmpl8
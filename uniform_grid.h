@@ -1,43 +1,119 @@
 #pragma once
-#include "precomp.h"
-#include "movable.h"
-// Notes Uniform Grid:
-// To have a grid where we can save in what tile each tank is then we can retrieve all neighboring tiles.
-// We need to have a tile save an general object from which we can parse an class.
-// We need to have a grid class to save the grid, get tiles and save a two dimensional array of tiles.
-// By using a two dimensional array for each column and row we can retrieve the neighboring tiles easily by
-// adding -1, 0 and 1 to the column and row to get the surrounding neighbors.
-// Terrain: 45 x 80 tiles
-// Screen: 1280 x 720
-// Need:
-//      Generalisation class for movable objects
-//          Type to be able to easily parse the object
-//      Grid class to build, manage and save the grid.
-//          List of tiles
-//          Get tile based on position
-//          Get moveables from all neighbors excluding the current object based on tile / position.
-//          Update grid based on old and new position to see if a object needs to be moved from a list.
-//
-// Working:
-//		Initialize grid
-//		Add frame 0, add all thanks to the grid.
-//		At every other frame update the grid during movement.
-//		Use Tmpl8::uniform_grid::get_neighboring_objects() to retrieve objects.
+
 namespace Tmpl8
 {
-	class uniform_grid
-	{
-	public:
-		vector<movable*> get_neighboring_objects(vec2 position);
-		void add_to_grid(movable* movable_object, vec2 position);
-		void update_grid(movable* movable_object, vec2 old_position, vec2 new_position);
-		mutex* mlock;
-
-	private:
-		std::array<std::array<std::list<movable*>, 45>, 80> grid;
-		static const int screen_width = 1280;
-		static const int screen_height = 720;
-		vec2 get_tile_indices(vec2 position);
-	};
-}
 
+// -----------------------------------------------------------
+// Uniform grid over the world, rebuilt from scratch whenever the entities moved.
+// Entries are indices into the caller's array plus a copy of the position, never
+// pointers, so nothing dangles when that array reallocates or is compacted.
+// The cells are stored compressed: all entries sorted by cell in one array and the
+// start of every cell in another, so a rebuild is a counting sort without allocations.
+// Positions outside the world are kept in the nearest border cell.
+// Building is single threaded, queries may run on any number of threads at once.
+// -----------------------------------------------------------
+class uniform_grid
+{
+  public:
+    explicit uniform_grid(vec2 world_size = vec2(1280.f, 720.f), float cell_size = 16.f);
+
+    //Rebuild: clear, add every entity, finish, only then query
+    void clear();
+    void add(uint32_t index, vec2 position) { pending.push_back({ index, position }); }
+    void finish();
+
+    //Calls func(index, position) for every entity in the cells that overlap the square
+    //of half size radius around center, the caller does the exact distance test
+    template <typename Func>
+    void for_each_near(vec2 center, float radius, Func func) const
+    {
+        const int x1 = cell_x(center.x - radius), x2 = cell_x(center.x + radius);
+        const int y1 = cell_y(center.y - radius), y2 = cell_y(center.y + radius);
+        for (int y = y1; y <= y2; y++)
+        {
+            const uint32_t* row_start = &cell_start[y * columns];
+            for (uint32_t i = row_start[x1]; i < row_start[x2 + 1]; i++)
+            {
+                func(entries[i].index, entries[i].position);
+            }
+        }
+    }
+
+    //Index of the entity closest to center for which accept(index) is true, -1 when there is none
+    //Searches rings of cells around center, only where they overlap the occupied cells,
+    //and stops once no closer entity can be in the next ring
+    template <typename Accept>
+    int find_nearest(vec2 center, Accept accept) const
+    {
+        if (entries.empty()) return -1;
+
+        const int center_x = cell_x(center.x), center_y = cell_y(center.y);
+
+        //Rings closer than the occupied cells are empty, rings past all of them don't exist
+        const int first_ring = std::max({ occupied_x1 - center_x, center_x - occupied_x2, occupied_y1 - center_y, center_y - occupied_y2, 0 });
+        const int last_ring = std::max({ occupied_x2 - center_x, center_x - occupied_x1, occupied_y2 - center_y, center_y - occupied_y1 });
+
+        int nearest = -1;
+        float nearest_distance = numeric_limits<float>::infinity();
+        const auto search_cell = [&](int x, int y) {
+            const int cell = y * columns + x;
+            for (uint32_t i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+            {
+                const float distance = (entries[i].position - center).sqr_length();
+                if (distance < nearest_distance && accept(entries[i].index))
+                {
+                    nearest_distance = distance;
+                    nearest = (int)entries[i].index;
+                }
+            }
+        };
+
+        for (int ring = first_ring; ring <= last_ring; ring++)
+        {
+            //Entities in this ring are at least ring - 1 cells away from center
+            const float ring_distance = std::max(0, ring - 1) * cell_size;
+            if (nearest >= 0 && ring_distance * ring_distance >= nearest_distance) break;
+
+            const int x1 = std::max(center_x - ring, occupied_x1), x2 = std::min(center_x + ring, occupied_x2);
+            const int y1 = std::max(center_y - ring, occupied_y1), y2 = std::min(center_y + ring, occupied_y2);
+            for (int y = y1; y <= y2; y++)
+            {
+                if (y == center_y - ring || y == center_y + ring)
+                {
+                    for (int x = x1; x <= x2; x++) search_cell(x, y);
+                }
+                else
+                {
+                    //Only the left and right cells of the ring in between its top and bottom row
+                    if (center_x - ring >= x1) search_cell(center_x - ring, y);
+                    if (center_x + ring <= x2 && ring > 0) search_cell(center_x + ring, y);
+                }
+            }
+        }
+        return nearest;
+    }
+
+    size_t size() const { return entries.size(); }
+
+  private:
+    struct Entry
+    {
+        uint32_t index;
+        vec2 position;
+    };
+
+    int cell_x(float x) const { return clamp((int)floorf(x * inverse_cell_size), 0, columns - 1); }
+    int cell_y(float y) const { return clamp((int)floorf(y * inverse_cell_size), 0, rows - 1); }
+
+    int columns, rows;
+    float cell_size, inverse_cell_size;
+
+    //Bounding box of the cells that hold entries
+    int occupied_x1 = 0, occupied_y1 = 0, occupied_x2 = -1, occupied_y2 = -1;
+
+    vector<Entry> pending;
+    vector<uint32_t> cell_start; //columns * rows + 1, cell c holds entries [cell_start[c], cell_start[c + 1])
+    vector<Entry> entries;
+};
+
+} // namespace Tmpl8